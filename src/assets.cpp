@@ -0,0 +1,134 @@
+//**********************************************************************************************************************
+// FILE: assets.cpp
+//
+// DESCRIPTION
+// Contains implementation for the asset cache
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "assets.hpp"
+
+#include <algorithm>
+#include <functional>
+
+AssetManager::AssetManager(cv::Point3f meshOffset, size_t capacity,
+                           const MovieCacheSettings &movieCache)
+    : meshOffset(meshOffset), capacity(std::max<size_t>(capacity, 1)),
+      movieCache(movieCache), useCount(0) {}
+
+AssetManager::~AssetManager() {
+    for (std::thread &loader : loaders) {
+        loader.join();
+    }
+}
+
+shared_ptr<const Mesh> AssetManager::readMesh(const string &path) {
+    shared_ptr<Mesh> mesh = make_shared<Mesh>();
+    if (!loadMesh(path, *mesh, meshOffset)) {
+        return nullptr;
+    }
+    return mesh;
+}
+
+shared_ptr<MovieSource> AssetManager::openMovie(const string &path) {
+    shared_ptr<MovieSource> movie = make_shared<MovieSource>();
+    if (!movie->open(path, movieCache)) {
+        return nullptr;
+    }
+    return movie;
+}
+
+void AssetManager::preload(const vector<string> &meshPaths,
+                           const vector<string> &moviePaths) {
+    // 1. add an entry for everything not cached yet
+    vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (const string &path : meshPaths) {
+            if (meshes.count(path) == 0) {
+                auto promise =
+                    make_shared<std::promise<shared_ptr<const Mesh>>>();
+                meshes[path] = {promise->get_future().share(), ++useCount};
+                tasks.push_back([this, promise, path]() {
+                    promise->set_value(readMesh(path));
+                });
+            }
+        }
+        for (const string &path : moviePaths) {
+            if (movies.count(path) == 0) {
+                auto promise =
+                    make_shared<std::promise<shared_ptr<MovieSource>>>();
+                movies[path] = {promise->get_future().share(), ++useCount};
+                tasks.push_back([this, promise, path]() {
+                    promise->set_value(openMovie(path));
+                });
+            }
+        }
+        evict(meshes);
+        evict(movies);
+    }
+
+    // 2. load them in parallel, off the calling thread
+    if (!tasks.empty()) {
+        loaders.push_back(std::thread([tasks]() {
+            cv::parallel_for_(cv::Range(0, tasks.size()),
+                              [&](const cv::Range &range) {
+                                  for (int i = range.start; i < range.end;
+                                       i++) {
+                                      tasks.at(i)();
+                                  }
+                              });
+        }));
+    }
+}
+
+template <typename T>
+shared_ptr<T> AssetManager::get(
+    map<string, Entry<T>> &table, const string &path,
+    shared_ptr<T> (AssetManager::*load)(const string &)) {
+    shared_future<shared_ptr<T>> value;
+    shared_ptr<std::promise<shared_ptr<T>>> promise;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        typename map<string, Entry<T>>::iterator it = table.find(path);
+        if (it != table.end()) {
+            it->second.lastUse = ++useCount;
+            value = it->second.value;
+        } else {
+            // not preloaded, load it on this thread
+            promise = make_shared<std::promise<shared_ptr<T>>>();
+            value = promise->get_future().share();
+            table[path] = {value, ++useCount};
+            evict(table);
+        }
+    }
+    if (promise) {
+        promise->set_value((this->*load)(path));
+    }
+    return value.get();
+}
+
+template <typename T>
+void AssetManager::evict(map<string, Entry<T>> &table) {
+    // the loader keeps its promise, dropping an entry that is still loading
+    // does not block
+    while (table.size() > capacity) {
+        typename map<string, Entry<T>>::iterator oldest = table.begin();
+        for (auto it = table.begin(); it != table.end(); it++) {
+            if (it->second.lastUse < oldest->second.lastUse) {
+                oldest = it;
+            }
+        }
+        table.erase(oldest);
+    }
+}
+
+shared_ptr<const Mesh> AssetManager::mesh(const string &path) {
+    return get(meshes, path, &AssetManager::readMesh);
+}
+
+shared_ptr<MovieSource> AssetManager::movie(const string &path) {
+    return get(movies, path, &AssetManager::openMovie);
+}
@@ -0,0 +1,98 @@
+//**********************************************************************************************************************
+// FILE: assets.hpp
+//
+// DESCRIPTION
+// Keeps the meshes and movies of the virtual objects in memory, so switching
+// object in the video loop only swaps a pointer. Assets are loaded in
+// parallel in the background and the least recently used ones are dropped
+// when there are more than the cache holds.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdint.h>
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mesh.hpp"
+#include "movie.hpp"
+
+class AssetManager {
+   public:
+    /**
+     * @param meshOffset added to every mesh, to place it on the chessboard
+     * @param capacity the number of meshes and of movies kept
+     * @param movieCache which movies are decoded into memory once
+     */
+    AssetManager(cv::Point3f meshOffset, size_t capacity,
+                 const MovieCacheSettings &movieCache = MovieCacheSettings());
+    ~AssetManager();
+
+    /**
+     * @brief Start loading the assets in the background, in parallel.
+     * Returns immediately.
+     *
+     * @param meshPaths the obj files
+     * @param moviePaths the movie files
+     */
+    void preload(const vector<string> &meshPaths,
+                 const vector<string> &moviePaths);
+
+    /**
+     * @brief Get a mesh. Waits if it is still loading and loads it now if it
+     * was not preloaded.
+     *
+     * @param path the obj file
+     * @return the mesh, or null if it could not be loaded
+     */
+    shared_ptr<const Mesh> mesh(const string &path);
+
+    /**
+     * @brief Get a movie, like mesh. The movie is decoding in the background
+     * from the time it is loaded and keeps its position between calls.
+     *
+     * @param path the movie file
+     * @return the movie, or null if it could not be opened
+     */
+    shared_ptr<MovieSource> movie(const string &path);
+
+   private:
+    template <typename T>
+    struct Entry {
+        shared_future<shared_ptr<T>> value;
+        uint64_t lastUse;
+    };
+
+    template <typename T>
+    shared_ptr<T> get(map<string, Entry<T>> &table, const string &path,
+                      shared_ptr<T> (AssetManager::*load)(const string &));
+
+    template <typename T>
+    void evict(map<string, Entry<T>> &table);
+
+    shared_ptr<const Mesh> readMesh(const string &path);
+    shared_ptr<MovieSource> openMovie(const string &path);
+
+    cv::Point3f meshOffset;
+    size_t capacity;
+    MovieCacheSettings movieCache;
+
+    std::mutex lock;  // guards the tables and useCount
+    map<string, Entry<const Mesh>> meshes;
+    map<string, Entry<MovieSource>> movies;
+    uint64_t useCount;
+
+    vector<std::thread> loaders;
+};
+
+#endif
@@ -0,0 +1,236 @@
+//**********************************************************************************************************************
+// FILE: bench.cpp
+//
+// DESCRIPTION
+// Contains implementation for the benchmarks
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "bench.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "bundle.hpp"
+using namespace std;
+
+void synthesizeViews(int numViews, cv::Size chessboardSize, cv::Size imageSize,
+                     cv::Mat &calibMatrix, cv::Mat &distortCoeff,
+                     vector<vector<cv::Point2f>> &listImagePoints,
+                     vector<vector<cv::Point3f>> &listWorldPoints) {
+    cv::RNG rng(42);  // same views on every run
+    calibMatrix = (cv::Mat_<double>(3, 3) << 800, 0, imageSize.width / 2.0, 0,
+                   800, imageSize.height / 2.0, 0, 0, 1);
+    distortCoeff =
+        (cv::Mat_<double>(1, 5) << -0.25, 0.08, 0.0005, -0.0004, 0.0);
+
+    vector<cv::Point3f> worldPoints;
+    createWorldPoints(chessboardSize, worldPoints);
+    float centerX = (chessboardSize.width - 1) / 2.0;
+    float centerY = -(chessboardSize.height - 1) / 2.0;
+
+    while (listImagePoints.size() < numViews) {
+        // 1. random pose looking at the board center
+        cv::Mat rotVec = (cv::Mat_<double>(3, 1) << rng.uniform(-0.6, 0.6),
+                          rng.uniform(-0.6, 0.6), rng.uniform(-0.3, 0.3));
+        cv::Mat transVec =
+            (cv::Mat_<double>(3, 1) << -centerX + rng.uniform(-4.0, 4.0),
+             -centerY + rng.uniform(-3.0, 3.0), rng.uniform(12.0, 30.0));
+
+        // 2. project and keep only views fully inside the image
+        vector<cv::Point2f> imagePoints;
+        cv::projectPoints(worldPoints, rotVec, transVec, calibMatrix,
+                          distortCoeff, imagePoints);
+        bool inside = true;
+        for (int i = 0; i < imagePoints.size(); i++) {
+            cv::Point2f &p = imagePoints.at(i);
+            if (p.x < 0 || p.y < 0 || p.x >= imageSize.width ||
+                p.y >= imageSize.height) {
+                inside = false;
+                break;
+            }
+            p.x += rng.gaussian(0.2);
+            p.y += rng.gaussian(0.2);
+        }
+        if (inside) {
+            listImagePoints.push_back(imagePoints);
+            listWorldPoints.push_back(worldPoints);
+        }
+    }
+}
+
+/**
+ * @brief print one line of the calibration benchmark
+ */
+static void printCalibResult(string name, double seconds, double error,
+                             cv::Mat &calibMatrix, cv::Mat &distortCoeff) {
+    printf("%-16s %9.3fs  rms %.4f  fx %.2f fy %.2f cx %.2f cy %.2f k1 %.4f\n",
+           name.c_str(), seconds, error, calibMatrix.at<double>(0, 0),
+           calibMatrix.at<double>(1, 1), calibMatrix.at<double>(0, 2),
+           calibMatrix.at<double>(1, 2), distortCoeff.at<double>(0, 0));
+}
+
+void benchCalibration(int numViews, int maxOpenCVViews) {
+    cv::Size chessboardSize(9, 6);
+    cv::Size imageSize(1280, 720);
+    cv::Mat trueMatrix, trueDistort;
+    vector<vector<cv::Point2f>> listImagePoints;
+    vector<vector<cv::Point3f>> listWorldPoints;
+    synthesizeViews(numViews, chessboardSize, imageSize, trueMatrix,
+                    trueDistort, listImagePoints, listWorldPoints);
+
+    cout << "calibration of " << numViews << " synthetic views, "
+         << cv::getNumThreads() << " threads" << endl;
+    printCalibResult("truth", 0, 0, trueMatrix, trueDistort);
+
+    cv::TermCriteria criteria = cv::TermCriteria(
+        cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, DBL_EPSILON);
+
+    // 1. current path
+    if (numViews <= maxOpenCVViews) {
+        cv::Mat calibMatrix, distortCoeff;
+        vector<cv::Mat> rotationVecs, translVecs;
+        int64 start = cv::getTickCount();
+        double error = cv::calibrateCamera(
+            listWorldPoints, listImagePoints, imageSize, calibMatrix,
+            distortCoeff, rotationVecs, translVecs, 0, criteria);
+        double seconds =
+            (cv::getTickCount() - start) / cv::getTickFrequency();
+        printCalibResult("calibrateCamera", seconds, error, calibMatrix,
+                         distortCoeff);
+    } else {
+        cout << "calibrateCamera  skipped, more than " << maxOpenCVViews
+             << " views" << endl;
+    }
+
+    // 2. bundle adjustment
+    cv::Mat calibMatrix, distortCoeff;
+    vector<cv::Mat> rotationVecs, translVecs;
+    int64 start = cv::getTickCount();
+    double error = bundleCalibrate(listWorldPoints, listImagePoints, imageSize,
+                                   calibMatrix, distortCoeff, rotationVecs,
+                                   translVecs, 0, criteria);
+    double seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+    printCalibResult("bundle", seconds, error, calibMatrix, distortCoeff);
+}
+
+// >>>>>>>>>>> Csv
+// the csv helpers as they were before CsvReader/CsvWriter, kept as the
+// baseline of the benchmark
+static int legacyGetString(FILE *fp, char os[]) {
+    int p = 0;
+    int eol = 0;
+    for (;;) {
+        char ch = fgetc(fp);
+        if (ch == ',') {
+            break;
+        } else if (ch == '\n' || ch == EOF) {
+            eol = 1;
+            break;
+        }
+        os[p] = ch;
+        p++;
+    }
+    os[p] = '\0';
+    return (eol);
+}
+
+static int legacyGetFloat(FILE *fp, float *v) {
+    char s[256];
+    int eol = legacyGetString(fp, s);
+    *v = atof(s);
+    return (eol);
+}
+
+static void legacyAppendRow(vector<cv::Point2f> &v2, vector<cv::Point3f> &v3,
+                            const char *csvfilepath, const char *imageName) {
+    FILE *fp = fopen(csvfilepath, "a");
+    std::fwrite(imageName, sizeof(char), strlen(imageName), fp);
+    for (int i = 0; i < v2.size(); i++) {
+        char tmp[256];
+        sprintf(tmp, ",%.4f,%.4f", v2[i].x, v2[i].y);
+        std::fwrite(tmp, sizeof(char), strlen(tmp), fp);
+    }
+    for (int i = 0; i < v3.size(); i++) {
+        char tmp[256];
+        sprintf(tmp, ",%.4f,%.4f,%.4f", v3[i].x, v3[i].y, v3[i].z);
+        std::fwrite(tmp, sizeof(char), strlen(tmp), fp);
+    }
+    std::fwrite("\n", sizeof(char), 1, fp);
+    fclose(fp);
+}
+
+static int legacyRead(const char *csvfilepath, int numPoints) {
+    FILE *fp = fopen(csvfilepath, "r");
+    char name[256];
+    int numViews = 0;
+    while (!legacyGetString(fp, name)) {
+        float fval;
+        for (int i = 0; i < numPoints * 5; i++) {
+            legacyGetFloat(fp, &fval);
+        }
+        numViews++;
+    }
+    fclose(fp);
+    return numViews;
+}
+
+void benchCsv(int numViews) {
+    cv::Size chessboardSize(9, 6);
+    cv::Mat calibMatrix, distortCoeff;
+    vector<vector<cv::Point2f>> listImagePoints;
+    vector<vector<cv::Point3f>> listWorldPoints;
+    synthesizeViews(numViews, chessboardSize, cv::Size(1280, 720), calibMatrix,
+                    distortCoeff, listImagePoints, listWorldPoints);
+    char legacyCsv[] = "bench_legacy.csv";
+    char newCsv[] = "bench_new.csv";
+    remove(legacyCsv);
+
+    cout << "csv of " << numViews << " views" << endl;
+
+    // 1. write
+    int64 start = cv::getTickCount();
+    for (int i = 0; i < numViews; i++) {
+        string name = "calibration_" + to_string(i) + ".png";
+        legacyAppendRow(listImagePoints.at(i), listWorldPoints.at(i),
+                        legacyCsv, name.c_str());
+    }
+    double legacyWrite = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    start = cv::getTickCount();
+    for (int i = 0; i < numViews; i++) {
+        string name = "calibration_" + to_string(i) + ".png";
+        appendPointVectorsToCsv(listImagePoints.at(i), listWorldPoints.at(i),
+                                newCsv, name.c_str(), i == 0);
+    }
+    double newWrite = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    // 2. read
+    start = cv::getTickCount();
+    legacyRead(legacyCsv, chessboardSize.area());
+    double legacyReadTime =
+        (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    vector<vector<cv::Point2f>> readImagePoints;
+    vector<vector<cv::Point3f>> readWorldPoints;
+    vector<char *> imageNames;
+    start = cv::getTickCount();
+    read2d3DVectorsFromCSV(newCsv, chessboardSize, readImagePoints,
+                           readWorldPoints, imageNames, 0);
+    double newRead = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    printf("%-8s %10s %10s %8s\n", "", "legacy", "new", "speedup");
+    printf("%-8s %9.3fs %9.3fs %7.1fx\n", "write", legacyWrite, newWrite,
+           legacyWrite / newWrite);
+    printf("%-8s %9.3fs %9.3fs %7.1fx\n", "read", legacyReadTime, newRead,
+           legacyReadTime / newRead);
+
+    for (int i = 0; i < imageNames.size(); i++) {
+        delete[] imageNames.at(i);
+    }
+    remove(legacyCsv);
+    remove(newCsv);
+}
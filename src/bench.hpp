@@ -0,0 +1,54 @@
+//**********************************************************************************************************************
+// FILE: bench.hpp
+//
+// DESCRIPTION
+// Contains benchmarks for the slow parts of the pipeline
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "filter.hpp"
+
+/**
+ * @brief Create chessboard views of a known camera seen from random poses,
+ * with 0.2 pixel noise on the corners. Every view is fully inside the image.
+ *
+ * @param numViews the number of views to create
+ * @param chessboardSize the width and height cell of the chessboard
+ * @param imageSize the size of the image
+ * @param calibMatrix the output camera matrix used
+ * @param distortCoeff the output distortion coefficient used
+ * @param listImagePoints the list to push the 2D points to
+ * @param listWorldPoints the list to push the 3D points to
+ */
+void synthesizeViews(int numViews, cv::Size chessboardSize, cv::Size imageSize,
+                     cv::Mat &calibMatrix, cv::Mat &distortCoeff,
+                     vector<vector<cv::Point2f>> &listImagePoints,
+                     vector<vector<cv::Point3f>> &listWorldPoints);
+
+/**
+ * @brief Time calibrateCamera against the bundle adjustment engine on
+ * synthetic views and print the time, error and recovered intrinsics.
+ * calibrateCamera is dense in the number of views, so it is skipped above
+ * maxOpenCVViews views.
+ *
+ * @param numViews the number of views
+ * @param maxOpenCVViews the largest number of views to run calibrateCamera on
+ */
+void benchCalibration(int numViews, int maxOpenCVViews);
+
+/**
+ * @brief Time writing and reading numViews calibration views as csv, with the
+ * old fgetc/sprintf helpers against the CsvReader/CsvWriter path.
+ *
+ * @param numViews the number of views
+ */
+void benchCsv(int numViews);
+
+#endif
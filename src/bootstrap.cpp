@@ -0,0 +1,177 @@
+//**********************************************************************************************************************
+// FILE: bootstrap.cpp
+//
+// DESCRIPTION
+// Contains implementation for the bootstrap uncertainty estimation
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "bootstrap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "bundle.hpp"
+using namespace std;
+
+static const char *PARAM_NAMES[9] = {"fx", "fy", "cx", "cy", "k1",
+                                     "k2", "p1", "p2", "k3"};
+
+// number of views with the most leverage to print
+static const int NUM_LEVERAGE_SHOWN = 5;
+
+BootstrapResult bootstrapCalibration(
+    const vector<vector<cv::Point3f>> &listWorldPoints,
+    const vector<vector<cv::Point2f>> &listImagePoints, cv::Size imageSize,
+    int numResamples, CalibEngine engine) {
+    int numViews = listImagePoints.size();
+
+    // 1. calibrate every resample concurrently, each one only writes its own
+    // row
+    vector<cv::Vec<double, 9>> params(numResamples);
+    vector<vector<int>> counts(numResamples, vector<int>(numViews, 0));
+    vector<unsigned char> failed(numResamples, 0);
+    cv::parallel_for_(cv::Range(0, numResamples), [&](const cv::Range &range) {
+        for (int b = range.start; b < range.end; b++) {
+            // - seeded by the resample index so runs are repeatable
+            cv::RNG rng(1234 + b);
+            vector<vector<cv::Point3f>> worldPoints;
+            vector<vector<cv::Point2f>> imagePoints;
+            for (int k = 0; k < numViews; k++) {
+                int i = rng.uniform(0, numViews);
+                worldPoints.push_back(listWorldPoints.at(i));
+                imagePoints.push_back(listImagePoints.at(i));
+                counts.at(b).at(i)++;
+            }
+
+            cv::Mat calibMatrix, distortCoeff;
+            vector<cv::Mat> rotationVecs, translVecs;
+            cv::TermCriteria criteria = cv::TermCriteria(
+                cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30,
+                DBL_EPSILON);
+            // - a resample can be degenerate, e.g. the same view drawn
+            // over and over, it is left out instead of ending the bootstrap
+            try {
+                if (engine == engineBundle) {
+                    bundleCalibrate(worldPoints, imagePoints, imageSize,
+                                    calibMatrix, distortCoeff, rotationVecs,
+                                    translVecs, 0, criteria);
+                } else {
+                    cv::calibrateCamera(worldPoints, imagePoints, imageSize,
+                                        calibMatrix, distortCoeff,
+                                        rotationVecs, translVecs, 0, criteria);
+                }
+            } catch (const cv::Exception &) {
+                failed.at(b) = 1;
+                continue;
+            }
+
+            cv::Vec<double, 9> &p = params.at(b);
+            p[0] = calibMatrix.at<double>(0, 0);
+            p[1] = calibMatrix.at<double>(1, 1);
+            p[2] = calibMatrix.at<double>(0, 2);
+            p[3] = calibMatrix.at<double>(1, 2);
+            for (int k = 0; k < 5; k++) {
+                p[4 + k] = distortCoeff.at<double>(k);
+            }
+        }
+    });
+
+    // 2. mean, standard deviation and percentiles of every parameter, over
+    // the resamples that calibrated
+    vector<int> good;
+    for (int b = 0; b < numResamples; b++) {
+        if (!failed.at(b)) {
+            good.push_back(b);
+        }
+    }
+    BootstrapResult result;
+    result.numResamples = good.size();
+    result.numFailed = numResamples - good.size();
+    result.leverage.assign(numViews, 0);
+    if (good.empty()) {
+        return result;
+    }
+    int numGood = good.size();
+    for (int p = 0; p < 9; p++) {
+        vector<double> values;
+        double sum = 0;
+        for (int b : good) {
+            values.push_back(params.at(b)[p]);
+            sum += params.at(b)[p];
+        }
+        double mean = sum / numGood;
+        double sqSum = 0;
+        for (int k = 0; k < numGood; k++) {
+            sqSum += (values.at(k) - mean) * (values.at(k) - mean);
+        }
+        std::sort(values.begin(), values.end());
+        result.mean[p] = mean;
+        result.stddev[p] = std::sqrt(sqSum / std::max(numGood - 1, 1));
+        result.low[p] = values.at((int)(0.025 * (numGood - 1)));
+        result.high[p] = values.at((int)(0.975 * (numGood - 1)));
+    }
+
+    // 3. leverage: compare the resamples without a view to all of them
+    for (int i = 0; i < numViews; i++) {
+        cv::Vec<double, 9> sum;
+        int numWithout = 0;
+        for (int b : good) {
+            if (counts.at(b).at(i) == 0) {
+                sum += params.at(b);
+                numWithout++;
+            }
+        }
+        if (numWithout == 0) {
+            continue;
+        }
+        double sqShift = 0;
+        for (int p = 0; p < 9; p++) {
+            if (result.stddev[p] > 0) {
+                double shift =
+                    (sum[p] / numWithout - result.mean[p]) / result.stddev[p];
+                sqShift += shift * shift;
+            }
+        }
+        result.leverage.at(i) = std::sqrt(sqShift);
+    }
+    return result;
+}
+
+void printBootstrapReport(const BootstrapResult &result,
+                          const vector<char *> &imageNames) {
+    cout << "\n=====Bootstrap of " << result.numResamples
+         << " resamples:" << endl;
+    if (result.numFailed > 0) {
+        cout << result.numFailed
+             << " degenerate resamples could not be calibrated, left out"
+             << endl;
+    }
+    if (result.numResamples == 0) {
+        return;
+    }
+    printf("%-4s %12s %12s %12s %12s\n", "", "mean", "std", "2.5%", "97.5%");
+    for (int p = 0; p < 9; p++) {
+        printf("%-4s %12.5f %12.5f %12.5f %12.5f\n", PARAM_NAMES[p],
+               result.mean[p], result.stddev[p], result.low[p],
+               result.high[p]);
+    }
+
+    // views sorted by leverage
+    vector<int> order;
+    for (int i = 0; i < result.leverage.size(); i++) {
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return result.leverage.at(a) > result.leverage.at(b);
+    });
+
+    cout << "views with the most leverage:" << endl;
+    for (int k = 0; k < NUM_LEVERAGE_SHOWN && k < order.size(); k++) {
+        int i = order.at(k);
+        printf("  %-32s %.3f\n", imageNames.at(i), result.leverage.at(i));
+    }
+}
@@ -0,0 +1,60 @@
+//**********************************************************************************************************************
+// FILE: bootstrap.hpp
+//
+// DESCRIPTION
+// Estimates how certain a calibration is by calibrating on resampled views
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "filter.hpp"
+
+/**
+ * @brief The spread of every intrinsic parameter over the resamples, in the
+ * order fx, fy, cx, cy, k1, k2, p1, p2, k3
+ */
+struct BootstrapResult {
+    cv::Vec<double, 9> mean;
+    cv::Vec<double, 9> stddev;
+    cv::Vec<double, 9> low;   // 2.5 percentile
+    cv::Vec<double, 9> high;  // 97.5 percentile
+    vector<double> leverage;  // how much leaving out a view moves the result
+    int numResamples;         // resamples that calibrated
+    int numFailed;            // degenerate resamples the solver threw on
+};
+
+/**
+ * @brief Bootstrap the calibration: draw the views with replacement
+ * numResamples times and calibrate every resample, concurrently on all cores.
+ * The leverage of a view is how far (in standard deviations) the mean of the
+ * resamples that do not contain it is from the overall mean. Resamples the
+ * solver fails on are left out of the statistics and counted.
+ *
+ * @param listWorldPoints the list of 3D points of the chessboard
+ * @param listImagePoints the list of 2D points of the chessboard
+ * @param imageSize the size of the calibration images
+ * @param numResamples how many resampled calibrations to run
+ * @param engine the calibration solver to use
+ * @return BootstrapResult the statistics of the intrinsics
+ */
+BootstrapResult bootstrapCalibration(
+    const vector<vector<cv::Point3f>> &listWorldPoints,
+    const vector<vector<cv::Point2f>> &listImagePoints, cv::Size imageSize,
+    int numResamples, CalibEngine engine);
+
+/**
+ * @brief Print the parameter statistics and the views with the most leverage
+ *
+ * @param result the bootstrap result
+ * @param imageNames the names of the images of every view
+ */
+void printBootstrapReport(const BootstrapResult &result,
+                          const vector<char *> &imageNames);
+
+#endif
@@ -0,0 +1,317 @@
+//**********************************************************************************************************************
+// FILE: bundle.cpp
+//
+// DESCRIPTION
+// Contains implementation for the sparse bundle adjustment calibration
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "bundle.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+using namespace std;
+
+// intrinsics: fx, fy, cx, cy, k1, k2, p1, p2, k3
+typedef cv::Vec<double, 9> Vec9;
+// extrinsics: rotation vector then translation vector
+typedef cv::Vec<double, 6> Vec6;
+typedef cv::Matx<double, 9, 9> Mat99;
+typedef cv::Matx<double, 6, 6> Mat66;
+typedef cv::Matx<double, 9, 6> Mat96;
+
+// residuals above this many pixels are down weighted (Huber loss)
+static const double HUBER_DELTA = 2.0;
+
+// stop when the cost improves by less than this fraction, if the criteria
+// have no EPS
+static const double MIN_COST_CHANGE = 1e-10;
+
+/**
+ * @brief The part of the normal equations that comes from a single view
+ */
+struct ViewBlock {
+    Mat99 U;  // intrinsic X intrinsic
+    Mat66 V;  // extrinsic X extrinsic
+    Mat96 W;  // intrinsic X extrinsic
+    Vec9 gc;  // intrinsic gradient
+    Vec6 ge;  // extrinsic gradient
+    double cost;     // robust cost
+    double sqError;  // plain squared reprojection error
+};
+
+static void toCameraMatrix(const Vec9 &c, cv::Mat &calibMatrix,
+                           cv::Mat &distortCoeff) {
+    calibMatrix = (cv::Mat_<double>(3, 3) << c[0], 0, c[2], 0, c[1], c[3], 0,
+                   0, 1);
+    distortCoeff = (cv::Mat_<double>(1, 5) << c[4], c[5], c[6], c[7], c[8]);
+}
+
+/**
+ * @brief Huber cost of a residual of length err, and its IRLS weight
+ */
+static double huber(double err, double &weight) {
+    if (err <= HUBER_DELTA) {
+        weight = 1;
+        return 0.5 * err * err;
+    }
+    weight = HUBER_DELTA / err;
+    return HUBER_DELTA * (err - 0.5 * HUBER_DELTA);
+}
+
+/**
+ * @brief Project one view and accumulate its cost and normal equations.
+ * projectPoints gives the jacobian columns in the order rvec(3), tvec(3),
+ * f(2), c(2), distortion(5), which is extrinsics then intrinsics.
+ */
+static void evaluateView(const vector<cv::Point3f> &worldPoints,
+                         const vector<cv::Point2f> &imagePoints, const Vec9 &c,
+                         const Vec6 &e, ViewBlock &block) {
+    cv::Mat calibMatrix, distortCoeff;
+    toCameraMatrix(c, calibMatrix, distortCoeff);
+    cv::Mat rotVec = (cv::Mat_<double>(3, 1) << e[0], e[1], e[2]);
+    cv::Mat transVec = (cv::Mat_<double>(3, 1) << e[3], e[4], e[5]);
+
+    vector<cv::Point2f> projected;
+    cv::Mat jacobian;
+    cv::projectPoints(worldPoints, rotVec, transVec, calibMatrix, distortCoeff,
+                      projected, jacobian);
+
+    block.U = Mat99();
+    block.V = Mat66();
+    block.W = Mat96();
+    block.gc = Vec9();
+    block.ge = Vec6();
+    block.cost = 0;
+    block.sqError = 0;
+
+    for (int k = 0; k < projected.size(); k++) {
+        double rx = projected.at(k).x - imagePoints.at(k).x;
+        double ry = projected.at(k).y - imagePoints.at(k).y;
+        double weight;
+        block.sqError += rx * rx + ry * ry;
+        block.cost += huber(std::sqrt(rx * rx + ry * ry), weight);
+
+        for (int row = 0; row < 2; row++) {
+            const double *je = jacobian.ptr<double>(2 * k + row);
+            const double *jc = je + 6;
+            double r = row == 0 ? rx : ry;
+
+            for (int a = 0; a < 9; a++) {
+                double wa = weight * jc[a];
+                block.gc[a] += wa * r;
+                for (int b = a; b < 9; b++) {
+                    block.U(a, b) += wa * jc[b];
+                }
+                for (int b = 0; b < 6; b++) {
+                    block.W(a, b) += wa * je[b];
+                }
+            }
+            for (int a = 0; a < 6; a++) {
+                double wa = weight * je[a];
+                block.ge[a] += wa * r;
+                for (int b = a; b < 6; b++) {
+                    block.V(a, b) += wa * je[b];
+                }
+            }
+        }
+    }
+
+    // only the upper triangles were accumulated
+    for (int a = 0; a < 9; a++) {
+        for (int b = 0; b < a; b++) {
+            block.U(a, b) = block.U(b, a);
+        }
+    }
+    for (int a = 0; a < 6; a++) {
+        for (int b = 0; b < a; b++) {
+            block.V(a, b) = block.V(b, a);
+        }
+    }
+}
+
+/**
+ * @brief Evaluate every view in parallel, return the total robust cost
+ */
+static double evaluateAll(const vector<vector<cv::Point3f>> &listWorldPoints,
+                          const vector<vector<cv::Point2f>> &listImagePoints,
+                          const Vec9 &c, const vector<Vec6> &extrinsics,
+                          vector<ViewBlock> &blocks) {
+    cv::parallel_for_(
+        cv::Range(0, listImagePoints.size()), [&](const cv::Range &range) {
+            for (int i = range.start; i < range.end; i++) {
+                evaluateView(listWorldPoints.at(i), listImagePoints.at(i), c,
+                             extrinsics.at(i), blocks.at(i));
+            }
+        });
+
+    // sum in order so the result does not depend on the threads
+    double cost = 0;
+    for (int i = 0; i < blocks.size(); i++) {
+        cost += blocks.at(i).cost;
+    }
+    return cost;
+}
+
+double bundleCalibrate(const vector<vector<cv::Point3f>> &listWorldPoints,
+                       const vector<vector<cv::Point2f>> &listImagePoints,
+                       cv::Size imageSize, cv::Mat &calibMatrix,
+                       cv::Mat &distortCoeff, vector<cv::Mat> &rotationVecs,
+                       vector<cv::Mat> &translVecs, int flags,
+                       cv::TermCriteria criteria) {
+    int numViews = listImagePoints.size();
+
+    // 1. initial intrinsics
+    Vec9 c;
+    int numGuessed = 0;
+    if (flags & cv::CALIB_USE_INTRINSIC_GUESS) {
+        cv::Mat guess, distortion;
+        calibMatrix.convertTo(guess, CV_64F);
+        c[0] = guess.at<double>(0, 0);
+        c[1] = guess.at<double>(1, 1);
+        c[2] = guess.at<double>(0, 2);
+        c[3] = guess.at<double>(1, 2);
+        if (!distortCoeff.empty()) {
+            distortCoeff.reshape(1, 1).convertTo(distortion, CV_64F);
+            for (int k = 0; k < 5 && k < distortion.cols; k++) {
+                c[4 + k] = distortion.at<double>(0, k);
+            }
+        }
+        numGuessed = std::min((int)rotationVecs.size(), numViews);
+    } else {
+        cv::Mat guess =
+            cv::initCameraMatrix2D(listWorldPoints, listImagePoints, imageSize);
+        c[0] = guess.at<double>(0, 0);
+        c[1] = guess.at<double>(1, 1);
+        c[2] = guess.at<double>(0, 2);
+        c[3] = guess.at<double>(1, 2);
+    }
+
+    // 2. initial extrinsics: keep the guessed ones, solvePnP for the rest
+    vector<Vec6> extrinsics(numViews);
+    for (int i = 0; i < numGuessed; i++) {
+        cv::Mat rotVec, transVec;
+        rotationVecs.at(i).convertTo(rotVec, CV_64F);
+        translVecs.at(i).convertTo(transVec, CV_64F);
+        for (int k = 0; k < 3; k++) {
+            extrinsics.at(i)[k] = rotVec.at<double>(k);
+            extrinsics.at(i)[3 + k] = transVec.at<double>(k);
+        }
+    }
+    cv::Mat initMatrix, initDistort;
+    toCameraMatrix(c, initMatrix, initDistort);
+    cv::parallel_for_(cv::Range(numGuessed, numViews), [&](const cv::Range &r) {
+        for (int i = r.start; i < r.end; i++) {
+            cv::Mat rotVec, transVec;
+            cv::solvePnP(listWorldPoints.at(i), listImagePoints.at(i),
+                         initMatrix, initDistort, rotVec, transVec);
+            for (int k = 0; k < 3; k++) {
+                extrinsics.at(i)[k] = rotVec.at<double>(k);
+                extrinsics.at(i)[3 + k] = transVec.at<double>(k);
+            }
+        }
+    });
+
+    // 3. Levenberg-Marquardt
+    vector<ViewBlock> blocks(numViews);
+    vector<ViewBlock> trialBlocks(numViews);
+    vector<Mat66> vInv(numViews);
+    vector<Mat96> wvInv(numViews);
+    vector<Vec6> trialExtrinsics(numViews);
+    double cost = evaluateAll(listWorldPoints, listImagePoints, c, extrinsics,
+                              blocks);
+    double lambda = 1e-3;
+    int maxIterations = (criteria.type & cv::TermCriteria::COUNT)
+                            ? criteria.maxCount
+                            : 30;
+    double epsilon = (criteria.type & cv::TermCriteria::EPS)
+                         ? criteria.epsilon
+                         : MIN_COST_CHANGE;
+
+    for (int iter = 0; iter < maxIterations; iter++) {
+        // - intrinsic block of the normal equations
+        Mat99 U;
+        Vec9 gc;
+        for (int i = 0; i < numViews; i++) {
+            U += blocks.at(i).U;
+            gc += blocks.at(i).gc;
+        }
+
+        bool accepted = false;
+        while (!accepted && lambda < 1e10) {
+            // - eliminate the extrinsics of every view (Schur complement)
+            cv::parallel_for_(cv::Range(0, numViews), [&](const cv::Range &r) {
+                for (int i = r.start; i < r.end; i++) {
+                    Mat66 V = blocks.at(i).V;
+                    for (int a = 0; a < 6; a++) {
+                        V(a, a) *= 1 + lambda;
+                    }
+                    vInv.at(i) = V.inv(cv::DECOMP_CHOLESKY);
+                    wvInv.at(i) = blocks.at(i).W * vInv.at(i);
+                }
+            });
+
+            Mat99 S = U;
+            for (int a = 0; a < 9; a++) {
+                S(a, a) *= 1 + lambda;
+            }
+            Vec9 rhs = -gc;
+            for (int i = 0; i < numViews; i++) {
+                S -= wvInv.at(i) * blocks.at(i).W.t();
+                rhs += wvInv.at(i) * blocks.at(i).ge;
+            }
+
+            // - solve the small intrinsic system, then back substitute
+            Vec9 dc = S.solve(rhs, cv::DECOMP_CHOLESKY);
+            Vec9 trialC = c + dc;
+            cv::parallel_for_(cv::Range(0, numViews), [&](const cv::Range &r) {
+                for (int i = r.start; i < r.end; i++) {
+                    Vec6 de = vInv.at(i) * (-blocks.at(i).ge -
+                                            blocks.at(i).W.t() * dc);
+                    trialExtrinsics.at(i) = extrinsics.at(i) + de;
+                }
+            });
+
+            double trialCost = evaluateAll(listWorldPoints, listImagePoints,
+                                           trialC, trialExtrinsics,
+                                           trialBlocks);
+            if (trialCost < cost) {
+                accepted = true;
+                double change = (cost - trialCost) / cost;
+                c = trialC;
+                extrinsics.swap(trialExtrinsics);
+                blocks.swap(trialBlocks);
+                cost = trialCost;
+                lambda = std::max(lambda / 3, 1e-12);
+                // - converged: the cost or the intrinsics barely moved
+                if (change < epsilon ||
+                    cv::norm(dc) <= epsilon * (cv::norm(c) + epsilon)) {
+                    iter = maxIterations;
+                }
+            } else {
+                lambda *= 4;
+            }
+        }
+        if (!accepted) {
+            break;  // no step improves the cost anymore
+        }
+    }
+
+    // 4. outputs in the same form as calibrateCamera
+    toCameraMatrix(c, calibMatrix, distortCoeff);
+    rotationVecs.resize(numViews);
+    translVecs.resize(numViews);
+    double sqError = 0;
+    int numPoints = 0;
+    for (int i = 0; i < numViews; i++) {
+        const Vec6 &e = extrinsics.at(i);
+        rotationVecs.at(i) = (cv::Mat_<double>(3, 1) << e[0], e[1], e[2]);
+        translVecs.at(i) = (cv::Mat_<double>(3, 1) << e[3], e[4], e[5]);
+        sqError += blocks.at(i).sqError;
+        numPoints += listImagePoints.at(i).size();
+    }
+    return std::sqrt(sqError / numPoints);
+}
@@ -0,0 +1,53 @@
+//**********************************************************************************************************************
+// FILE: bundle.hpp
+//
+// DESCRIPTION
+// A camera calibration solver for very large numbers of views. It is a
+// Levenberg-Marquardt bundle adjustment that uses the sparsity of the problem:
+// every view only depends on the intrinsics and its own extrinsics, so the
+// extrinsics are eliminated with the Schur complement and only a 9X9 system is
+// solved per iteration.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "filter.hpp"
+
+/**
+ * @brief Calibrate the camera with the sparse bundle adjustment. Same inputs
+ * and outputs as cv::calibrateCamera with 5 distortion coefficients. The
+ * residuals and jacobians of the views are evaluated in parallel, and a Huber
+ * loss keeps a few bad corners from pulling the solution.
+ *
+ * With CALIB_USE_INTRINSIC_GUESS the given calibMatrix and distortCoeff are
+ * the starting point, and so are the extrinsics of the first
+ * rotationVecs.size() views; the other views get an initial pose from
+ * solvePnP. Without it everything is initialised from scratch.
+ *
+ * @param listWorldPoints the list of 3D points of the chessboard
+ * @param listImagePoints the list of 2D points of the chessboard
+ * @param imageSize the size of the calibration images
+ * @param calibMatrix the camera matrix, input guess and output
+ * @param distortCoeff the distortion coefficient, input guess and output
+ * @param rotationVecs the rotation of every view, input guess and output
+ * @param translVecs the translation of every view, input guess and output
+ * @param flags 0 or CALIB_USE_INTRINSIC_GUESS
+ * @param criteria when to stop iterating: COUNT caps the iterations, EPS
+ * stops once a step changes the cost, or the intrinsics, by less than that
+ * fraction
+ * @return double the rms reprojection error
+ */
+double bundleCalibrate(const vector<vector<cv::Point3f>> &listWorldPoints,
+                       const vector<vector<cv::Point2f>> &listImagePoints,
+                       cv::Size imageSize, cv::Mat &calibMatrix,
+                       cv::Mat &distortCoeff, vector<cv::Mat> &rotationVecs,
+                       vector<cv::Mat> &translVecs, int flags,
+                       cv::TermCriteria criteria);
+
+#endif
@@ -0,0 +1,82 @@
+//**********************************************************************************************************************
+// FILE: calibworker.cpp
+//
+// DESCRIPTION
+// Contains implementation for the background calibration
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "calibworker.hpp"
+
+#include <iostream>
+
+#include "overlay.hpp"
+using namespace std;
+
+CalibrationWorker::CalibrationWorker() : running(false) {}
+
+CalibrationWorker::~CalibrationWorker() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool CalibrationWorker::request(
+    cv::Size imageSize, const vector<vector<cv::Point3f>> &listWorldPoints,
+    const vector<vector<cv::Point2f>> &listImagePoints,
+    const vector<char *> &imageNames, bool fullSolve) {
+    if (running) {
+        return false;
+    }
+
+    // 1. the previous run is done, release its thread
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    // 2. snapshot the views so the video loop can keep adding new ones
+    worldPoints = listWorldPoints;
+    imagePoints = listImagePoints;
+    names.clear();
+    for (int i = 0; i < imageNames.size(); i++) {
+        names.push_back(string(imageNames.at(i)));
+    }
+
+    // 3. start
+    running = true;
+    thread = std::thread(&CalibrationWorker::run, this, imageSize, fullSolve);
+    return true;
+}
+
+bool CalibrationWorker::busy() const { return running; }
+
+std::shared_ptr<const Intrinsics> CalibrationWorker::latest() const {
+    return std::atomic_load(&current);
+}
+
+void CalibrationWorker::run(cv::Size imageSize, bool fullSolve) {
+    // 1. calibrating only needs the size of the frame
+    cv::Mat frame(imageSize, CV_8UC3);
+    vector<char *> imageNames;
+    for (int i = 0; i < names.size(); i++) {
+        imageNames.push_back(&names.at(i)[0]);
+    }
+    calibrating(frame, worldPoints, imagePoints, imageNames, state, fullSolve);
+
+    // 2. publish a new snapshot, readers holding the old one keep it alive
+    std::shared_ptr<Intrinsics> result = std::make_shared<Intrinsics>();
+    result->calibMatrix = state.calibMatrix.clone();
+    result->distortCoeff = state.distortCoeff.clone();
+    // - the map for 'u' is slow to build, better here than in the video loop
+    if (!result->calibMatrix.empty()) {
+        buildUndistortMap(result->calibMatrix, result->distortCoeff, imageSize,
+                          result->undistortMap);
+    }
+    result->error = state.error;
+    result->numViews = imagePoints.size();
+    std::atomic_store(&current, std::shared_ptr<const Intrinsics>(result));
+
+    running = false;
+}
@@ -0,0 +1,83 @@
+//**********************************************************************************************************************
+// FILE: calibworker.hpp
+//
+// DESCRIPTION
+// Runs the camera calibration on a background thread and publishes the result
+// as an immutable snapshot that the video loop can pick up on the next frame
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef CALIBWORKER_H
+#define CALIBWORKER_H
+
+#include <atomic>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filter.hpp"
+
+/**
+ * @brief A calibration result. Once published it is never modified, so the
+ * matrices can be shared with the pose and render code without copying.
+ */
+struct Intrinsics {
+    cv::Mat calibMatrix;   // 3X3 matrix
+    cv::Mat distortCoeff;  // 1X5 matrix
+    cv::Mat undistortMap;  // buildUndistortMap for the calibration images
+    double error;          // rms reprojection error
+    int numViews;          // number of views used
+};
+
+class CalibrationWorker {
+   public:
+    CalibrationWorker();
+    ~CalibrationWorker();
+
+    /**
+     * @brief Take a snapshot of the views and start calibrating them in the
+     * background. Nothing is started if a calibration is still running.
+     *
+     * @param imageSize the size of the calibration images
+     * @param listWorldPoints the list of 3D points of the chessboard
+     * @param listImagePoints the list of 2D points of the chessboard
+     * @param imageNames the names of the images of every view
+     * @param fullSolve true to ignore the previous solution
+     * @return true if the calibration was started
+     */
+    bool request(cv::Size imageSize,
+                 const vector<vector<cv::Point3f>> &listWorldPoints,
+                 const vector<vector<cv::Point2f>> &listImagePoints,
+                 const vector<char *> &imageNames, bool fullSolve);
+
+    /**
+     * @brief true while a calibration is running
+     */
+    bool busy() const;
+
+    /**
+     * @brief The latest published calibration, or null if there is none yet.
+     * Safe to call from any thread.
+     */
+    std::shared_ptr<const Intrinsics> latest() const;
+
+   private:
+    void run(cv::Size imageSize, bool fullSolve);
+
+    std::thread thread;
+    std::atomic<bool> running;
+
+    // snapshot of the views, only touched by the worker thread while running
+    vector<vector<cv::Point3f>> worldPoints;
+    vector<vector<cv::Point2f>> imagePoints;
+    vector<string> names;
+    CalibrationState state;
+
+    // swapped atomically, never modified after it is published
+    std::shared_ptr<const Intrinsics> current;
+};
+
+#endif
@@ -0,0 +1,279 @@
+//**********************************************************************************************************************
+// FILE: csv.cpp
+//
+// DESCRIPTION
+// Contains implementation for the csv reader and writer
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "csv.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+// size of the write buffer, the file is written when it is full
+static const size_t WRITE_BUFFER_SIZE = 1 << 16;
+
+// longest number we read or write
+static const size_t MAX_NUMBER_LENGTH = 64;
+
+// >>>>>>>>>>> Reader
+CsvReader::CsvReader()
+    : data(NULL), pos(NULL), end(NULL), size(0), mapped(false) {}
+
+CsvReader::~CsvReader() { close(); }
+
+bool CsvReader::open(const char *path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat buffer;
+    if (fstat(fd, &buffer) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // 1. map the file, an empty file has nothing to read
+    size = buffer.st_size;
+    if (size > 0) {
+        void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            data = (const char *)p;
+            mapped = true;
+        } else {
+            // 2. can not map (e.g. a pipe), read it all instead
+            char *heap = new char[size];
+            size_t got = 0;
+            ssize_t n;
+            while (got < size && (n = read(fd, heap + got, size - got)) > 0) {
+                got += n;
+            }
+            data = heap;
+            size = got;
+        }
+    }
+    ::close(fd);
+
+    pos = data;
+    end = data + size;
+    return true;
+}
+
+void CsvReader::close() {
+    if (data) {
+        if (mapped) {
+            munmap((void *)data, size);
+        } else {
+            delete[] data;
+        }
+    }
+    data = pos = end = NULL;
+    size = 0;
+    mapped = false;
+}
+
+int CsvReader::nextField(const char *&first, const char *&last) {
+    // 1. find the end of the field
+    const char *p = pos;
+    while (p < end && *p != ',' && *p != '\n') {
+        p++;
+    }
+    first = pos;
+    last = p;
+    int eol = (p >= end || *p == '\n');
+    pos = p < end ? p + 1 : end;
+
+    // 2. windows line endings and spaces around the value
+    if (last > first && last[-1] == '\r') {
+        last--;
+    }
+    while (first < last && *first == ' ') {
+        first++;
+    }
+    return eol;
+}
+
+int CsvReader::readString(string &out) {
+    const char *first, *last;
+    int eol = nextField(first, last);
+    out.assign(first, last);
+    return eol;
+}
+
+int CsvReader::readInt(int *v) {
+    const char *first, *last;
+    int eol = nextField(first, last);
+    if (first < last && *first == '+') {
+        first++;
+    }
+    *v = 0;
+    std::from_chars(first, last, *v);
+    return eol;
+}
+
+int CsvReader::readHex(unsigned long long *v) {
+    const char *first, *last;
+    int eol = nextField(first, last);
+    *v = 0;
+    std::from_chars(first, last, *v, 16);
+    return eol;
+}
+
+/**
+ * @brief Parse a floating point number, 0 if it is not one (like atof)
+ */
+template <typename T>
+static T parseReal(const char *first, const char *last) {
+    if (first < last && *first == '+') {
+        first++;
+    }
+    T v = 0;
+#if defined(__cpp_lib_to_chars)
+    std::from_chars(first, last, v);
+#else
+    // standard libraries without floating point from_chars: strtod on a
+    // bounded copy of the field
+    char s[MAX_NUMBER_LENGTH];
+    size_t n = std::min((size_t)(last - first), MAX_NUMBER_LENGTH - 1);
+    memcpy(s, first, n);
+    s[n] = '\0';
+    v = strtod(s, NULL);
+#endif
+    return v;
+}
+
+int CsvReader::readFloat(float *v) {
+    const char *first, *last;
+    int eol = nextField(first, last);
+    *v = parseReal<float>(first, last);
+    return eol;
+}
+
+int CsvReader::readDouble(double *v) {
+    const char *first, *last;
+    int eol = nextField(first, last);
+    *v = parseReal<double>(first, last);
+    return eol;
+}
+
+// >>>>>>>>>>> Writer
+CsvWriter::CsvWriter() : fp(NULL), used(0), lineStart(true) {}
+
+CsvWriter::~CsvWriter() { close(); }
+
+bool CsvWriter::open(const char *path, bool append) {
+    close();
+    fp = fopen(path, append ? "a" : "w");
+    if (!fp) {
+        return false;
+    }
+    // we buffer ourselves
+    setvbuf(fp, NULL, _IONBF, 0);
+    buffer.resize(WRITE_BUFFER_SIZE);
+    used = 0;
+    lineStart = true;
+    return true;
+}
+
+char *CsvWriter::reserve(size_t n) {
+    if (used + n > buffer.size()) {
+        flush();
+    }
+    return &buffer[used];
+}
+
+void CsvWriter::separator() {
+    if (!lineStart) {
+        *reserve(1) = ',';
+        used++;
+    }
+    lineStart = false;
+}
+
+void CsvWriter::writeString(const char *s) {
+    separator();
+    size_t n = strlen(s);
+    if (n > buffer.size()) {
+        // longer than the whole buffer, write it directly
+        flush();
+        fwrite(s, sizeof(char), n, fp);
+        return;
+    }
+    memcpy(reserve(n), s, n);
+    used += n;
+}
+
+void CsvWriter::writeInt(long long v) {
+    separator();
+    char *p = reserve(MAX_NUMBER_LENGTH);
+    used += std::to_chars(p, p + MAX_NUMBER_LENGTH, v).ptr - p;
+}
+
+void CsvWriter::writeHex(unsigned long long v) {
+    separator();
+    char *p = reserve(MAX_NUMBER_LENGTH);
+    used += std::to_chars(p, p + MAX_NUMBER_LENGTH, v, 16).ptr - p;
+}
+
+void CsvWriter::writeFixed(double v, int precision) {
+    separator();
+    char *p = reserve(MAX_NUMBER_LENGTH);
+#if defined(__cpp_lib_to_chars)
+    std::to_chars_result r = std::to_chars(
+        p, p + MAX_NUMBER_LENGTH, v, std::chars_format::fixed, precision);
+    if (r.ec == std::errc()) {
+        used += r.ptr - p;
+        return;
+    }
+#endif
+    // too long for fixed notation, or no floating point to_chars
+    int n = snprintf(p, MAX_NUMBER_LENGTH, "%.*f", precision, v);
+    if (n < 0 || (size_t)n >= MAX_NUMBER_LENGTH) {
+        n = snprintf(p, MAX_NUMBER_LENGTH, "%.*g", precision, v);
+    }
+    used += std::min((size_t)std::max(n, 0), MAX_NUMBER_LENGTH - 1);
+}
+
+void CsvWriter::writeDouble(double v) {
+    separator();
+    char *p = reserve(MAX_NUMBER_LENGTH);
+#if defined(__cpp_lib_to_chars)
+    used += std::to_chars(p, p + MAX_NUMBER_LENGTH, v).ptr - p;
+#else
+    used += snprintf(p, MAX_NUMBER_LENGTH, "%.17g", v);
+#endif
+}
+
+void CsvWriter::endLine() {
+    *reserve(1) = '\n';
+    used++;
+    lineStart = true;
+}
+
+void CsvWriter::flush() {
+    if (fp && used > 0) {
+        fwrite(buffer.data(), sizeof(char), used, fp);
+    }
+    used = 0;
+}
+
+void CsvWriter::close() {
+    if (fp) {
+        flush();
+        fclose(fp);
+    }
+    fp = NULL;
+    lineStart = true;
+}
@@ -0,0 +1,106 @@
+//**********************************************************************************************************************
+// FILE: csv.hpp
+//
+// DESCRIPTION
+// Fast reading and writing of the csv files used for calibration. The reader
+// maps the whole file and parses fields in place, the writer formats into one
+// large buffer and keeps its file open.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef CSV_H
+#define CSV_H
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+using namespace std;
+
+class CsvReader {
+   public:
+    CsvReader();
+    ~CsvReader();
+
+    /**
+     * @brief Map a csv file for reading
+     *
+     * @param path the csv file
+     * @return true if the file could be opened
+     */
+    bool open(const char *path);
+    void close();
+
+    /**
+     * @brief true once every field was read
+     */
+    bool eof() const { return pos >= end; }
+
+    /**
+     * @brief Read the next field. Like the old getstring, the return value is
+     * true if the field was the last one of its line (or of the file).
+     *
+     * @param out the field, without the separator
+     * @return int true if it reached the end of the line
+     */
+    int readString(string &out);
+    int readInt(int *v);
+    int readFloat(float *v);
+    int readDouble(double *v);
+
+    /**
+     * @brief Read a field as a hexadecimal number
+     */
+    int readHex(unsigned long long *v);
+
+   private:
+    int nextField(const char *&first, const char *&last);
+
+    const char *data;
+    const char *pos;
+    const char *end;
+    size_t size;
+    bool mapped;  // data is a mapping, not a heap buffer
+};
+
+class CsvWriter {
+   public:
+    CsvWriter();
+    ~CsvWriter();
+
+    /**
+     * @brief Open a csv file for writing
+     *
+     * @param path the csv file
+     * @param append true to append to it, false to overwrite it
+     * @return true if the file could be opened
+     */
+    bool open(const char *path, bool append);
+    bool isOpen() const { return fp != NULL; }
+
+    // - fields, separated by commas within a line
+    void writeString(const char *s);
+    void writeInt(long long v);
+    void writeFixed(double v, int precision);  // like %.<precision>f
+    void writeDouble(double v);  // shortest text that reads back exactly
+    void writeHex(unsigned long long v);
+    void endLine();
+
+    /**
+     * @brief Write the buffer to the file (the file stays open)
+     */
+    void flush();
+    void close();
+
+   private:
+    char *reserve(size_t n);
+    void separator();
+
+    FILE *fp;
+    vector<char> buffer;
+    size_t used;
+    bool lineStart;
+};
+
+#endif
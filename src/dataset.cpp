@@ -0,0 +1,289 @@
+//**********************************************************************************************************************
+// FILE: dataset.cpp
+//
+// DESCRIPTION
+// Contains implementation for the binary calibration dataset
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "dataset.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+/**
+ * @brief round up to the next multiple of 8
+ */
+static uint64_t align8(uint64_t offset) { return (offset + 7) & ~(uint64_t)7; }
+
+/**
+ * @brief true if count items of itemSize bytes at offset are inside a file of
+ * size bytes and aligned for 4 byte reads. No sum or product can overflow.
+ */
+static bool sectionFits(uint64_t offset, uint64_t count, uint64_t itemSize,
+                        uint64_t size) {
+    if (offset > size || offset % 4 != 0) {
+        return false;
+    }
+    uint64_t room = size - offset;
+    return count == 0 || count <= room / itemSize;
+}
+
+CalibDataset::CalibDataset() : data(NULL), size(0), header(NULL) {}
+
+CalibDataset::~CalibDataset() { close(); }
+
+bool CalibDataset::open(const string &path) {
+    close();
+
+    // 1. map the whole file
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat buffer;
+    if (fstat(fd, &buffer) != 0 ||
+        (size_t)buffer.st_size < sizeof(DatasetHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *mapped =
+        mmap(NULL, buffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping stays valid
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    data = (const char *)mapped;
+    size = buffer.st_size;
+    header = (const DatasetHeader *)data;
+
+    // 2. check the header and that every section is inside the file
+    uint64_t numViews = header->numViews;
+    uint64_t numPoints = header->numPoints;
+    bool valid =
+        memcmp(header->magic, DATASET_MAGIC, 4) == 0 &&
+        header->version == DATASET_VERSION && header->fileSize == size &&
+        numPoints == (uint64_t)header->boardWidth * header->boardHeight &&
+        sectionFits(header->worldOffset, numPoints, sizeof(cv::Point3f),
+                    size) &&
+        (numPoints == 0 || numViews <= size / numPoints) &&
+        sectionFits(header->imageOffset, numViews * numPoints,
+                    sizeof(cv::Point2f), size) &&
+        sectionFits(header->nameIndexOffset, numViews + 1, sizeof(uint32_t),
+                    size) &&
+        header->nameDataOffset <= size;
+
+    // 3. every name starts after the one before, ends inside the name data
+    // and is null terminated
+    if (valid) {
+        const uint32_t *nameIndex =
+            (const uint32_t *)(data + header->nameIndexOffset);
+        uint64_t nameDataSize = size - header->nameDataOffset;
+        const char *nameData = data + header->nameDataOffset;
+        valid = nameIndex[numViews] <= nameDataSize;
+        for (uint64_t i = 0; valid && i < numViews; i++) {
+            valid = nameIndex[i] < nameIndex[i + 1] &&
+                    nameData[nameIndex[i + 1] - 1] == '\0';
+        }
+    }
+    if (!valid) {
+        printf("%s is not a valid calibration dataset\n", path.c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CalibDataset::close() {
+    if (data) {
+        munmap((void *)data, size);
+    }
+    data = NULL;
+    size = 0;
+    header = NULL;
+}
+
+cv::Size CalibDataset::boardSize() const {
+    return cv::Size(header->boardWidth, header->boardHeight);
+}
+
+const cv::Point3f *CalibDataset::worldPoints() const {
+    return (const cv::Point3f *)(data + header->worldOffset);
+}
+
+const cv::Point2f *CalibDataset::imagePoints(int view) const {
+    return (const cv::Point2f *)(data + header->imageOffset) +
+           (size_t)view * header->numPoints;
+}
+
+const char *CalibDataset::imageName(int view) const {
+    const uint32_t *nameIndex =
+        (const uint32_t *)(data + header->nameIndexOffset);
+    return data + header->nameDataOffset + nameIndex[view];
+}
+
+int writeCalibDataset(const string &path, cv::Size chessboardSize,
+                      vector<vector<cv::Point2f>> &listImagePoints,
+                      vector<vector<cv::Point3f>> &listWorldPoints,
+                      vector<char *> &imageNames) {
+    uint32_t numViews = listImagePoints.size();
+    uint32_t numPoints = chessboardSize.width * chessboardSize.height;
+
+    // 1. every view must fit the shared tables
+    for (int i = 0; i < numViews; i++) {
+        if (listImagePoints.at(i).size() != numPoints ||
+            listWorldPoints.at(i) != listWorldPoints.at(0)) {
+            printf("view %d does not fit the shared world points\n", i);
+            return (-1);
+        }
+    }
+
+    // 2. name table
+    vector<uint32_t> nameIndex;
+    string nameData;
+    for (int i = 0; i < numViews; i++) {
+        nameIndex.push_back(nameData.size());
+        nameData.append(imageNames.at(i));
+        nameData.push_back('\0');
+    }
+    nameIndex.push_back(nameData.size());
+
+    // 3. header
+    DatasetHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DATASET_MAGIC, 4);
+    header.version = DATASET_VERSION;
+    header.boardWidth = chessboardSize.width;
+    header.boardHeight = chessboardSize.height;
+    header.numViews = numViews;
+    header.numPoints = numPoints;
+    header.worldOffset = align8(sizeof(DatasetHeader));
+    header.imageOffset =
+        align8(header.worldOffset + numPoints * sizeof(cv::Point3f));
+    header.nameIndexOffset = align8(
+        header.imageOffset + (uint64_t)numViews * numPoints *
+                                 sizeof(cv::Point2f));
+    header.nameDataOffset = align8(header.nameIndexOffset +
+                                   nameIndex.size() * sizeof(uint32_t));
+    header.fileSize = header.nameDataOffset + nameData.size();
+
+    // 4. write to a temporary file and rename, so a reader never maps a half
+    // written file
+    string tmpPath = path + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp) {
+        printf("Unable to open output file %s\n", tmpPath.c_str());
+        return (-1);
+    }
+    const char zeros[8] = {0};
+    uint64_t written = 0;
+    fwrite(&header, sizeof(header), 1, fp);
+    written += sizeof(header);
+
+    fwrite(zeros, 1, header.worldOffset - written, fp);
+    if (numViews > 0) {
+        fwrite(listWorldPoints.at(0).data(), sizeof(cv::Point3f), numPoints,
+               fp);
+    }
+    written = header.worldOffset + numPoints * sizeof(cv::Point3f);
+
+    fwrite(zeros, 1, header.imageOffset - written, fp);
+    for (int i = 0; i < numViews; i++) {
+        fwrite(listImagePoints.at(i).data(), sizeof(cv::Point2f), numPoints,
+               fp);
+    }
+    written = header.imageOffset +
+              (uint64_t)numViews * numPoints * sizeof(cv::Point2f);
+
+    fwrite(zeros, 1, header.nameIndexOffset - written, fp);
+    fwrite(nameIndex.data(), sizeof(uint32_t), nameIndex.size(), fp);
+    written = header.nameIndexOffset + nameIndex.size() * sizeof(uint32_t);
+
+    fwrite(zeros, 1, header.nameDataOffset - written, fp);
+    fwrite(nameData.data(), 1, nameData.size(), fp);
+
+    bool failed = ferror(fp);
+    fclose(fp);
+    if (failed || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        printf("Unable to write %s\n", path.c_str());
+        remove(tmpPath.c_str());
+        return (-1);
+    }
+    return (0);
+}
+
+int readCalibDataset(const string &path, cv::Size chessboardSize,
+                     vector<vector<cv::Point2f>> &listImagePoints,
+                     vector<vector<cv::Point3f>> &listWorldPoints,
+                     vector<char *> &imageNames) {
+    CalibDataset dataset;
+    if (!dataset.open(path)) {
+        return (-1);
+    }
+    if (dataset.boardSize() != chessboardSize) {
+        printf("%s is for another chessboard size\n", path.c_str());
+        return (-1);
+    }
+
+    // copy the arrays straight into the lists
+    int numPoints = dataset.numPoints();
+    vector<cv::Point3f> worldPoints(dataset.worldPoints(),
+                                    dataset.worldPoints() + numPoints);
+    for (int i = 0; i < dataset.numViews(); i++) {
+        const cv::Point2f *imagePoints = dataset.imagePoints(i);
+        listImagePoints.push_back(
+            vector<cv::Point2f>(imagePoints, imagePoints + numPoints));
+        listWorldPoints.push_back(worldPoints);
+
+        const char *name = dataset.imageName(i);
+        char *fname = new char[strlen(name) + 1];
+        strcpy(fname, name);
+        imageNames.push_back(fname);
+    }
+    return (0);
+}
+
+int loadCalibrationViews(char *src_csv, cv::Size chessboardSize,
+                         vector<vector<cv::Point2f>> &listImagePoints,
+                         vector<vector<cv::Point3f>> &listWorldPoints,
+                         vector<char *> &imageNames) {
+    // 1. binary dataset next to the csv file
+    string binPath = src_csv;
+    size_t dot = binPath.find_last_of('.');
+    binPath = binPath.substr(0, dot).append(".bin");
+
+    struct stat csvStat, binStat;
+    bool hasCsv = stat(src_csv, &csvStat) == 0;
+    bool hasBin = stat(binPath.c_str(), &binStat) == 0;
+
+    // 2. use it if the csv file did not change since it was written. mtime
+    // is in seconds, so a csv file changed in the same second is parsed again
+    if (hasBin && (!hasCsv || binStat.st_mtime > csvStat.st_mtime)) {
+        if (readCalibDataset(binPath, chessboardSize, listImagePoints,
+                             listWorldPoints, imageNames) == 0) {
+            printf("Read %d views from %s\n", (int)listImagePoints.size(),
+                   binPath.c_str());
+            return (0);
+        }
+        listImagePoints.clear();
+        listWorldPoints.clear();
+        imageNames.clear();
+    }
+
+    // 3. otherwise parse the csv file and convert it for next time
+    if (read2d3DVectorsFromCSV(src_csv, chessboardSize, listImagePoints,
+                               listWorldPoints, imageNames, 0) != 0) {
+        return (-1);
+    }
+    writeCalibDataset(binPath, chessboardSize, listImagePoints,
+                      listWorldPoints, imageNames);
+    return (0);
+}
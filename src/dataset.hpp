@@ -0,0 +1,124 @@
+//**********************************************************************************************************************
+// FILE: dataset.hpp
+//
+// DESCRIPTION
+// Binary calibration dataset that is memory mapped instead of parsed
+//
+// The file is laid out as
+//   DatasetHeader
+//   world points   numPoints X 3 floats, shared by every view
+//   image points   numViews X numPoints X 2 floats
+//   name offsets   numViews + 1 uint32, into the name data
+//   name data      0-terminated image names
+// with every section aligned to 8 bytes.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stdint.h>
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "filter.hpp"
+
+static const char DATASET_MAGIC[4] = {'C', 'A', 'L', 'D'};
+static const uint32_t DATASET_VERSION = 1;
+
+struct DatasetHeader {
+    char magic[4];  // DATASET_MAGIC
+    uint32_t version;
+    uint32_t boardWidth;
+    uint32_t boardHeight;
+    uint32_t numViews;
+    uint32_t numPoints;  // corners per view
+    uint64_t worldOffset;
+    uint64_t imageOffset;
+    uint64_t nameIndexOffset;
+    uint64_t nameDataOffset;
+    uint64_t fileSize;
+};
+
+/**
+ * @brief Read only view of a binary dataset file. The file is memory mapped,
+ * the points are used where they are without any parsing.
+ */
+class CalibDataset {
+   public:
+    CalibDataset();
+    ~CalibDataset();
+
+    /**
+     * @brief Map a dataset file and check its header, that every section is
+     * inside the file and that the name table is well formed
+     *
+     * @param path the binary dataset file
+     * @return true if the file is a valid dataset of this version
+     */
+    bool open(const string &path);
+    void close();
+
+    int numViews() const { return header->numViews; }
+    int numPoints() const { return header->numPoints; }
+    cv::Size boardSize() const;
+    const cv::Point3f *worldPoints() const;
+    const cv::Point2f *imagePoints(int view) const;
+    const char *imageName(int view) const;
+
+   private:
+    const char *data;
+    size_t size;
+    const DatasetHeader *header;
+};
+
+/**
+ * @brief Write the views to a binary dataset file. Every view must have the
+ * same world points.
+ *
+ * @param path the binary dataset file
+ * @param chessboardSize the width and height cell of the chessboard
+ * @param listImagePoints the list of 2D points
+ * @param listWorldPoints the list of 3D points
+ * @param imageNames the names of the image
+ * @return int 0 if successful, -1 if not
+ */
+int writeCalibDataset(const string &path, cv::Size chessboardSize,
+                      vector<vector<cv::Point2f>> &listImagePoints,
+                      vector<vector<cv::Point3f>> &listWorldPoints,
+                      vector<char *> &imageNames);
+
+/**
+ * @brief Load the views of a binary dataset file into the lists used for
+ * calibration.
+ *
+ * @return int 0 if successful, -1 if the file is missing, invalid or for
+ * another chessboard size
+ */
+int readCalibDataset(const string &path, cv::Size chessboardSize,
+                     vector<vector<cv::Point2f>> &listImagePoints,
+                     vector<vector<cv::Point3f>> &listWorldPoints,
+                     vector<char *> &imageNames);
+
+/**
+ * @brief Load the saved calibration views. Uses the binary dataset next to
+ * the csv file (same name, .bin) when it is newer than the csv file (a csv
+ * file changed in the same second as the .bin is parsed again),
+ * otherwise reads the csv file and writes the binary dataset for next time.
+ *
+ * @param src_csv the csv file that contains 2D and 3D points
+ * @param chessboardSize the size of the chessboard
+ * @param listImagePoints the list of 2D points
+ * @param listWorldPoints the list of 3D points
+ * @param imageNames the names of the image
+ * @return int 0 if successful, -1 if there are no saved views
+ */
+int loadCalibrationViews(char *src_csv, cv::Size chessboardSize,
+                         vector<vector<cv::Point2f>> &listImagePoints,
+                         vector<vector<cv::Point3f>> &listWorldPoints,
+                         vector<char *> &imageNames);
+
+#endif
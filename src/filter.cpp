@@ -10,90 +10,22 @@
 
 #include "filter.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>  //used for file handling
 #include <iostream>
+#include <mutex>
 #include <opencv2/aruco.hpp>
 #include <string>  //used for strings
+#include <thread>
+
+#include "bundle.hpp"
+#include "csv.hpp"
+#include "reprojection.hpp"
+#include "simplify.hpp"
 using namespace std;
 
 // >>>>>>>>>>> Helper functions
-/*
-  Reads a string from a CSV file fp. the 0-terminated string is returned in the
-  char array os. The function returns false if it is successfully read. It
-  returns true if it reaches the end of the line or the file.
- */
-int getstring(FILE *fp, char os[]) {
-    int p = 0;
-    int eol = 0;
-
-    for (;;) {
-        char ch = fgetc(fp);
-        if (ch == ',') {
-            break;
-        } else if (ch == '\n' || ch == EOF) {
-            eol = 1;
-            break;
-        }
-        // printf("%c", ch ); // uncomment for debugging
-        os[p] = ch;
-        p++;
-    }
-    // printf("\n"); // uncomment for debugging
-    os[p] = '\0';
-    return (eol);  // return true if eol
-}
-
-int getint(FILE *fp, int *v) {
-    char s[256];
-    int p = 0;
-    int eol = 0;
-
-    for (;;) {
-        char ch = fgetc(fp);
-        if (ch == ',') {
-            break;
-        } else if (ch == '\n' || ch == EOF) {
-            eol = 1;
-            break;
-        }
-
-        s[p] = ch;
-        p++;
-    }
-    s[p] = '\0';  // terminator
-    *v = atoi(s);
-
-    return (eol);  // return true if eol
-}
-
-/*
-  Utility function for reading one float value from a CSV file
-  The value is stored in the v parameter
-  The function returns true if it reaches the end of a line or the file
- */
-int getfloat(FILE *fp, float *v) {
-    char s[256];
-    int p = 0;
-    int eol = 0;
-
-    for (;;) {
-        char ch = fgetc(fp);
-        if (ch == ',') {
-            break;
-        } else if (ch == '\n' || ch == EOF) {
-            eol = 1;
-            break;
-        }
-
-        s[p] = ch;
-        p++;
-    }
-    s[p] = '\0';  // terminator
-    *v = atof(s);
-
-    return (eol);  // return true if eol
-}
-
 string getNewFileName(string pathName, string imgName) {
     // create img name
     int fileIdx = 0;
@@ -122,42 +54,69 @@ string getNewFileName(string pathName, string imgName) {
 }
 
 // >>>>>>>>>>> Task1
-void drawOnChessboard(cv::Mat &src, cv::Mat &dst,
-                      vector<cv::Point2f> &outputImagePoints,
-                      cv::Size chessboardSize) {
+bool findChessboard(cv::Mat &src, vector<cv::Point2f> &outputImagePoints,
+                    cv::Size chessboardSize, bool fastCheck) {
     // 1. make grey frame
     cv::Mat srcGray;
     cv::cvtColor(src, srcGray, cv::COLOR_BGR2GRAY);
 
     // 2. find chessboardimagePoints
-    bool found = findChessboardCorners(
-        src, chessboardSize, outputImagePoints,
-        cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_FILTER_QUADS);
-
-    // cout << "corners: " <<imagePoints << "size: " << chessboardSize;
-
-    // 3. parameters for corner subpix
-    cv::Size wnSize = cv::Size(5, 5);
-    cv::Size zeroZone = cv::Size(-1, -1);
-    cv::TermCriteria criteria = cv::TermCriteria(
-        cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 40, 0.001);
-    ;
+    int flags = cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_FILTER_QUADS;
+    if (fastCheck) {
+        flags |= cv::CALIB_CB_FAST_CHECK;
+    }
+    bool found = findChessboardCorners(src, chessboardSize, outputImagePoints,
+                                       flags);
 
-    // 4. if it finds something use cornersSubpix on the grey image to get more
+    // 3. if it finds something use cornersSubpix on the grey image to get more
     // accurate location
-    src.copyTo(dst);
     if (found) {
         cv::Size winSize = cv::Size(5, 5);
         cv::Size zeroZone = cv::Size(-1, -1);
+        cv::TermCriteria criteria = cv::TermCriteria(
+            cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 40, 0.001);
         cv::cornerSubPix(srcGray, outputImagePoints, winSize, zeroZone,
                          criteria);
+    }
+    return found;
+}
+
+void drawOnChessboard(cv::Mat &src, cv::Mat &dst,
+                      vector<cv::Point2f> &outputImagePoints,
+                      cv::Size chessboardSize) {
+    bool found =
+        findChessboard(src, outputImagePoints, chessboardSize, false);
 
+    src.copyTo(dst);
+    if (found) {
         cv::drawChessboardCorners(dst, chessboardSize, outputImagePoints,
                                   found);
     }
 }
 
 // >>>>>>>>>>> Task2
+
+// decimals of the points in res/imageWorldPoints.csv
+static const int POINT_DECIMALS = 4;
+
+/**
+ * @brief The value a coordinate reads back as from res/imageWorldPoints.csv
+ */
+static float roundAsSaved(float v) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", POINT_DECIMALS, v);
+    return strtod(text, NULL);
+}
+void createWorldPoints(cv::Size chessboardSize,
+                       vector<cv::Point3f> &worldPoints) {
+    for (int i = 0; i < chessboardSize.height; i++) {
+        for (int j = 0; j < chessboardSize.width; j++) {
+            worldPoints.push_back(
+                cv::Point3f((float)j * 1.0, (float)i * -1.0, 0));
+        }
+    }
+}
+
 /**
  * @brief utility function to save 2D and 3D points to csv file called
  * imageWorldPoints.csv
@@ -172,40 +131,33 @@ void drawOnChessboard(cv::Mat &src, cv::Mat &dst,
 int appendPointVectorsToCsv(vector<cv::Point2f> &v2, vector<cv::Point3f> &v3,
                             char *csvfilepath, const char *image_filename,
                             int reset_file) {
-    char buffer[256];
-    char mode[8];
-    FILE *fp;
-
-    strcpy(mode, "a");
-
-    if (reset_file) {
-        strcpy(mode, "w");
-    }
-
-    fp = fopen(csvfilepath, mode);
-    if (!fp) {
-        printf("Unable to open output file %s\n", csvfilepath);
-        exit(-1);
+    // the writer stays open between rows, it is only reopened for another
+    // file or to reset the file
+    static CsvWriter writer;
+    static string writerPath;
+    if (reset_file || !writer.isOpen() || writerPath != csvfilepath) {
+        if (!writer.open(csvfilepath, !reset_file)) {
+            printf("Unable to open output file %s\n", csvfilepath);
+            exit(-1);
+        }
+        writerPath = csvfilepath;
     }
 
     // write the filename and the feature vector to the CSV file
-    strcpy(buffer, image_filename);
-
-    std::fwrite(buffer, sizeof(char), strlen(buffer), fp);
+    writer.writeString(image_filename);
     for (int i = 0; i < v2.size(); i++) {
-        char tmp[256];
-        sprintf(tmp, ",%.4f,%.4f", v2[i].x, v2[i].y);
-        std::fwrite(tmp, sizeof(char), strlen(tmp), fp);
+        writer.writeFixed(v2[i].x, POINT_DECIMALS);
+        writer.writeFixed(v2[i].y, POINT_DECIMALS);
     }
 
     for (int i = 0; i < v3.size(); i++) {
-        char tmp[256];
-        sprintf(tmp, ",%.4f,%.4f,%.4f", v3[i].x, v3[i].y, v3[i].z);
-        std::fwrite(tmp, sizeof(char), strlen(tmp), fp);
+        writer.writeFixed(v3[i].x, POINT_DECIMALS);
+        writer.writeFixed(v3[i].y, POINT_DECIMALS);
+        writer.writeFixed(v3[i].z, POINT_DECIMALS);
     }
 
-    std::fwrite("\n", sizeof(char), 1, fp);  // EOL
-    fclose(fp);
+    writer.endLine();  // EOL
+    writer.flush();    // the row is on disk if the program is killed
     return (0);
 }
 
@@ -216,22 +168,28 @@ void savePointsCsvVector(cv::Size chessboardSize,
                          vector<vector<cv::Point3f>> &listWorldPoints,
                          char *imgName, std::vector<char *> &imageNames) {
     if (imagePoints.size() > 0) {
-        // 1. save image points to vector
-        listImagePoints.push_back(vector<cv::Point2f>(imagePoints));
+        // 1. save image points to vector, as they will be read back from the
+        // csv so the dataset hash does not change after a restart
+        vector<cv::Point2f> savedImagePoints;
+        for (const cv::Point2f &p : imagePoints) {
+            savedImagePoints.push_back(
+                cv::Point2f(roundAsSaved(p.x), roundAsSaved(p.y)));
+        }
+        listImagePoints.push_back(savedImagePoints);
 
         // - create world points if it doesnt exist yet
         if (worldPoints.size() == 0) {
             cout << "create the first world points" << endl;
-            for (int i = 0; i < chessboardSize.height; i++) {
-                for (int j = 0; j < chessboardSize.width; j++) {
-                    worldPoints.push_back(
-                        cv::Point3f((float)j * 1.0, (float)i * -1.0, 0));
-                }
-            }
+            createWorldPoints(chessboardSize, worldPoints);
         }
 
         // 2. save world points to vector
-        listWorldPoints.push_back(vector<cv::Point3f>(worldPoints));
+        vector<cv::Point3f> savedWorldPoints;
+        for (const cv::Point3f &p : worldPoints) {
+            savedWorldPoints.push_back(cv::Point3f(
+                roundAsSaved(p.x), roundAsSaved(p.y), roundAsSaved(p.z)));
+        }
+        listWorldPoints.push_back(savedWorldPoints);
 
         // 3. write to csv
         char csvFile[] = "res/imageWorldPoints.csv";
@@ -243,8 +201,8 @@ void savePointsCsvVector(cv::Size chessboardSize,
         for (int i = 0; i < imageNames.size(); i++) {
             cout << imageNames.at(i) << endl;
         }
-        appendPointVectorsToCsv(imagePoints, worldPoints, csvFile, imgNameChar,
-                                0);
+        appendPointVectorsToCsv(savedImagePoints, savedWorldPoints, csvFile,
+                                imgNameChar, 0);
 
     } else {
         cout << "no chessboard detected " << endl;
@@ -263,129 +221,366 @@ string saveImage(cv::Mat frame, string imgPrefix) {
 
 // >>>>>>>>>>>>> Task3
 // util functions to append vectors to csv files
-void appendRotationTranslationVector(cv::Mat rotationVec, cv::Mat translVec,
-                                     char *&imageName, char *csvfilepath,
-                                     int reset_file) {
-    char buffer[256];
-    char mode[8];
-    FILE *fp;
-
-    strcpy(mode, "a");  // append
-
-    if (reset_file) {
-        strcpy(mode, "w");
-    }
-
-    fp = fopen(csvfilepath, mode);
-    if (!fp) {
-        printf("Unable to open output file %s\n", csvfilepath);
-        exit(-1);
-    }
-    string w = "w";
-    string modestr = string(mode);
-    if (w.compare(modestr) == 0) {
-        // 1. title
-        char title[] =
-            "imageName,rotRow_0,rotRow_1,rotRow2,tranlRow_0,tranlRow_1,"
-            "tranlRow2";
-        std::fwrite(title, sizeof(char), strlen(title), fp);
-        std::fwrite("\n", sizeof(char), 1, fp);
+/**
+ * @brief Write the extrinsics of every view to a csv file in one pass, at full
+ * double precision, and the same numbers to a binary sidecar next to it
+ * (same name, .bin): "CALR", version, number of views, then rotation and
+ * translation (6 doubles) per view.
+ */
+static void writeExtrinsics(string csvfilepath, vector<cv::Mat> rotationVecs,
+                            vector<cv::Mat> translVecs, vector<string> names) {
+    // 1. csv
+    CsvWriter writer;
+    if (!writer.open(csvfilepath.c_str(), false)) {
+        printf("Unable to open output file %s\n", csvfilepath.c_str());
+        return;
     }
-
-    // 1. write filename to buffer
-    strcpy(buffer, imageName);
-    std::fwrite(buffer, sizeof(char), strlen(buffer), fp);
-
-    // 2. write rotation vector
-    for (int i = 0; i < rotationVec.rows; i++) {
-        for (int j = 0; j < rotationVec.cols; j++) {
-            // - grab a single row
-            char tmp[256];
-            sprintf(tmp, ",%.4f", rotationVec.at<double>(i, j));
-            std::fwrite(tmp, sizeof(char), strlen(tmp), fp);
+    writer.writeString(
+        "imageName,rotRow_0,rotRow_1,rotRow2,tranlRow_0,tranlRow_1,"
+        "tranlRow2");
+    writer.endLine();
+
+    vector<double> values;
+    for (int v = 0; v < rotationVecs.size(); v++) {
+        cv::Mat rotVec, transVec;
+        rotationVecs.at(v).convertTo(rotVec, CV_64F);
+        translVecs.at(v).convertTo(transVec, CV_64F);
+
+        writer.writeString(names.at(v).c_str());
+        for (int i = 0; i < 3; i++) {
+            writer.writeDouble(rotVec.at<double>(i));
+            values.push_back(rotVec.at<double>(i));
         }
-    }
-
-    // 3. write translation vector (3rows X 1 col)
-    for (int i = 0; i < translVec.rows; i++) {
-        for (int j = 0; j < translVec.cols; j++) {
-            // - grab a single row
-            char tmp[256];
-            sprintf(tmp, ",%.4f", translVec.at<double>(i, j));
-            std::fwrite(tmp, sizeof(char), strlen(tmp), fp);
+        for (int i = 0; i < 3; i++) {
+            writer.writeDouble(transVec.at<double>(i));
+            values.push_back(transVec.at<double>(i));
         }
+        writer.endLine();
     }
+    writer.close();
 
-    std::fwrite("\n", sizeof(char), 1, fp);  // EOL
+    // 2. binary sidecar
+    string binPath = csvfilepath.substr(0, csvfilepath.find_last_of('.'));
+    binPath.append(".bin");
+    FILE *fp = fopen(binPath.c_str(), "wb");
+    if (!fp) {
+        printf("Unable to open output file %s\n", binPath.c_str());
+        return;
+    }
+    uint32_t header[3] = {0x524c4143, 1, (uint32_t)rotationVecs.size()};
+    fwrite(header, sizeof(uint32_t), 3, fp);  // "CALR", version, views
+    fwrite(values.data(), sizeof(double), values.size(), fp);
     fclose(fp);
 }
 
-void appendDistortionCalibMatrix(cv::Mat distortCoeff, cv::Mat calibMatrix,
-                                 char *csvfilepath, int reset_file) {
-    char mode[8];
-    FILE *fp;
-
-    strcpy(mode, "a");  // append
-
-    if (reset_file) {
-        strcpy(mode, "w");
+// held while res/distortionCalibMatrix.csv is read or written, calibrating
+// runs on the calibration worker while the video loop may read the file
+static std::mutex calibFilesLock;
+
+// the export of the previous calibration, an export waits for it so two never
+// write the same files. Joined at exit by the destructor
+static struct ExtrinsicsExport {
+    std::thread thread;
+    ~ExtrinsicsExport() { wait(); }
+    void wait() {
+        if (thread.joinable()) {
+            thread.join();
+        }
     }
+} extrinsicsExport;
 
-    fp = fopen(csvfilepath, mode);
-    if (!fp) {
+void appendDistortionCalibMatrix(cv::Mat distortCoeff, cv::Mat calibMatrix,
+                                 char *csvfilepath, int reset_file) {
+    CsvWriter writer;
+    if (!writer.open(csvfilepath, !reset_file)) {
         printf("Unable to open output file %s\n", csvfilepath);
         exit(-1);
     }
 
     // 1. name
-    char calibName[] = "calib_matrix";
-    std::fwrite(calibName, sizeof(char), strlen(calibName), fp);
+    writer.writeString("calib_matrix");
 
     // 2. calibration matrix
     for (int i = 0; i < calibMatrix.rows; i++) {
         for (int j = 0; j < calibMatrix.cols; j++) {
-            // - append the row to csv
-            char tmp[256];
-            sprintf(tmp, ",%.4f", calibMatrix.at<double>(i, j));
-            std::fwrite(tmp, sizeof(char), strlen(tmp), fp);
+            writer.writeFixed(calibMatrix.at<double>(i, j), 4);
         }
     }
-    std::fwrite("\n", sizeof(char), 1, fp);  // EOL
+    writer.endLine();  // EOL
 
-    char distortName[] = "distortion_coeff";
-    std::fwrite(distortName, sizeof(char), strlen(distortName), fp);
+    writer.writeString("distortion_coeff");
 
     // 3. write distortion coeff
     for (int i = 0; i < distortCoeff.rows; i++) {
         for (int j = 0; j < distortCoeff.cols; j++) {
-            // - append the row to csv
-            char tmp[256];
-            sprintf(tmp, ",%.4f", distortCoeff.at<double>(i, j));
-            std::fwrite(tmp, sizeof(char), strlen(tmp), fp);
+            writer.writeFixed(distortCoeff.at<double>(i, j), 4);
         }
     }
-    std::fwrite("\n", sizeof(char), 1, fp);  // EOL
-    fclose(fp);
+    writer.endLine();  // EOL
+}
+
+/**
+ * @brief utility function to append the hash of the dataset a calibration was
+ * made from to the intrinsics csv file
+ */
+void appendDatasetHash(unsigned long long datasetHash, char *csvfilepath) {
+    CsvWriter writer;
+    if (!writer.open(csvfilepath, true)) {
+        printf("Unable to open output file %s\n", csvfilepath);
+        exit(-1);
+    }
+    writer.writeString("dataset_hash");
+    writer.writeHex(datasetHash);
+    writer.endLine();
+}
+
+unsigned long long readDatasetHashFromCSV(char *src_csv) {
+    std::lock_guard<std::mutex> guard(calibFilesLock);
+    CsvReader reader;
+    if (!reader.open(src_csv)) {
+        return 0;
+    }
+
+    // the hash has its own line after the matrices
+    string name;
+    while (!reader.eof()) {
+        int eol = reader.readString(name);
+        if (!eol && name == "dataset_hash") {
+            unsigned long long datasetHash;
+            reader.readHex(&datasetHash);
+            return datasetHash;
+        }
+        // - skip the rest of the line
+        while (!eol) {
+            eol = reader.readString(name);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief FNV-1a hash of a block of memory, continuing from hash
+ */
+static unsigned long long fnv1a(const void *data, size_t size,
+                                unsigned long long hash) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
 }
 
+/**
+ * @brief Continue a hash with coordinates, rounded to POINT_DECIMALS
+ */
+static unsigned long long hashCoordinates(const float *values, size_t count,
+                                          unsigned long long hash) {
+    const double scale = std::pow(10.0, POINT_DECIMALS);
+    for (size_t i = 0; i < count; i++) {
+        long long rounded = std::llround(values[i] * scale);
+        hash = fnv1a(&rounded, sizeof(rounded), hash);
+    }
+    return hash;
+}
+
+unsigned long long hashCalibrationDataset(
+    vector<vector<cv::Point3f>> &listWorldPoints,
+    vector<vector<cv::Point2f>> &listImagePoints, cv::Size imageSize,
+    CalibrationState &state) {
+    unsigned long long hash = 14695981039346656037ULL;
+
+    // 1. what the solve depends on besides the points
+    int settings[4] = {imageSize.width, imageSize.height, (int)state.engine,
+                       (int)listImagePoints.size()};
+    hash = fnv1a(settings, sizeof(settings), hash);
+    hash = fnv1a(&state.rejectThreshold, sizeof(double), hash);
+
+    // 2. every point as it is saved, with the number of points of each view
+    for (int i = 0; i < listImagePoints.size(); i++) {
+        int sizes[2] = {(int)listImagePoints.at(i).size(),
+                        (int)listWorldPoints.at(i).size()};
+        hash = fnv1a(sizes, sizeof(sizes), hash);
+        hash = hashCoordinates(
+            (const float *)listImagePoints.at(i).data(), sizes[0] * 2, hash);
+        hash = hashCoordinates(
+            (const float *)listWorldPoints.at(i).data(), sizes[1] * 3, hash);
+    }
+
+    // 0 means no hash in the csv file
+    return hash == 0 ? 1 : hash;
+}
+
+void readCalibDistorCoeffFromCSV(char *src_csv, cv::Mat &calibMatrix,
+                                 cv::Mat &distortCoeff);
+
+// how many times calibrating drops outlier views and solves again
+static const int MAX_REJECT_ROUNDS = 5;
+
 void calibrating(cv::Mat srcFrame, vector<vector<cv::Point3f>> &listWorldPoints,
                  vector<vector<cv::Point2f>> &listImagePoints,
                  std::vector<char *> &imageNames) {
+    CalibrationState state;
+    calibrating(srcFrame, listWorldPoints, listImagePoints, imageNames, state,
+                true);
+}
+
+void calibrating(cv::Mat srcFrame, vector<vector<cv::Point3f>> &listWorldPoints,
+                 vector<vector<cv::Point2f>> &listImagePoints,
+                 std::vector<char *> &imageNames, CalibrationState &state,
+                 bool fullSolve) {
+    char distortCalibCsv[] = "res/distortionCalibMatrix.csv";
+
+    // 0. nothing to do if the dataset did not change since the last solve
+    unsigned long long datasetHash = hashCalibrationDataset(
+        listWorldPoints, listImagePoints, srcFrame.size(), state);
+    if (!fullSolve && !state.calibMatrix.empty() &&
+        state.datasetHash == datasetHash) {
+        cout << "dataset unchanged, keeping the calibration (error "
+             << state.error << ")" << endl;
+        return;
+    }
+    if (!fullSolve && state.calibMatrix.empty() &&
+        readDatasetHashFromCSV(distortCalibCsv) == datasetHash) {
+        // - solved in an earlier run, only the intrinsics are saved
+        readCalibDistorCoeffFromCSV(distortCalibCsv, state.calibMatrix,
+                                    state.distortCoeff);
+        state.imageSize = srcFrame.size();
+        state.datasetHash = datasetHash;
+        cout << "dataset unchanged, using the calibration in "
+             << string(distortCalibCsv) << endl;
+        return;
+    }
+
     // 1, extrinsic output
     vector<cv::Mat> rotationVecs;
     vector<cv::Mat> translVecs;
 
     // 2. intrinsic output
-    double calibVal[3][3] = {{1, 0, (double)srcFrame.cols / 2},
-                             {0, 1, (double)srcFrame.rows / 2},
-                             {0, 0, 1}};
-    cv::Mat calibMatrix = cv::Mat(3, 3, CV_64FC1, calibVal);
+    cv::Mat calibMatrix;
     cv::Mat distortCoeff;
+    int flags = 0;
+    cv::TermCriteria criteria = cv::TermCriteria(
+        cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, DBL_EPSILON);
+
+    // - warm start only if the previous solution is for the same camera and
+    // none of its views were removed since
+    bool warmStart = !fullSolve && !state.calibMatrix.empty() &&
+                     state.imageSize == srcFrame.size() &&
+                     state.rotationVecs.size() <= listImagePoints.size();
+
+    if (warmStart) {
+        calibMatrix = state.calibMatrix.clone();
+        distortCoeff = state.distortCoeff.clone();
+
+        // - we start close to the optimum so a few iterations are enough
+        flags = cv::CALIB_USE_INTRINSIC_GUESS;
+        criteria.maxCount = 10;
+        cout << "warm start from " << state.rotationVecs.size()
+             << " solved views, " << listImagePoints.size() -
+                                         state.rotationVecs.size()
+             << " new" << endl;
+    } else {
+        double calibVal[3][3] = {{1, 0, (double)srcFrame.cols / 2},
+                                 {0, 1, (double)srcFrame.rows / 2},
+                                 {0, 0, 1}};
+        cv::Mat(3, 3, CV_64FC1, calibVal).copyTo(calibMatrix);
+    }
+
+    // - the views to solve with, views rejected before stay rejected
+    vector<int> active;
+    for (int i = 0; i < listImagePoints.size(); i++) {
+        if (!(warmStart && i < state.rejected.size() && state.rejected.at(i))) {
+            active.push_back(i);
+        }
+    }
+
+    // - the bundle adjustment can also start from the previous poses. The
+    // solved views come first in active, so the guesses are a prefix
+    if (state.engine == engineBundle && warmStart) {
+        for (int i = 0; i < active.size(); i++) {
+            if (active.at(i) < state.rotationVecs.size()) {
+                rotationVecs.push_back(
+                    state.rotationVecs.at(active.at(i)).clone());
+                translVecs.push_back(
+                    state.translVecs.at(active.at(i)).clone());
+            }
+        }
+    }
+
+    // 3. get the projection matrix and record the error, then drop the views
+    // that do not fit and solve again
+    double error = 0;
+    vector<ViewError> viewErrors;
+    for (int round = 0; round < MAX_REJECT_ROUNDS; round++) {
+        vector<vector<cv::Point3f>> worldPoints;
+        vector<vector<cv::Point2f>> imagePoints;
+        for (int i = 0; i < active.size(); i++) {
+            worldPoints.push_back(listWorldPoints.at(active.at(i)));
+            imagePoints.push_back(listImagePoints.at(active.at(i)));
+        }
+
+        if (state.engine == engineBundle) {
+            error = bundleCalibrate(worldPoints, imagePoints, srcFrame.size(),
+                                    calibMatrix, distortCoeff, rotationVecs,
+                                    translVecs, flags, criteria);
+        } else {
+            error = cv::calibrateCamera(worldPoints, imagePoints,
+                                        srcFrame.size(), calibMatrix,
+                                        distortCoeff, rotationVecs, translVecs,
+                                        flags, criteria);
+        }
+
+        // - per view errors and their worst corner
+        computeReprojectionErrors(worldPoints, imagePoints, calibMatrix,
+                                  distortCoeff, rotationVecs, translVecs,
+                                  viewErrors);
+
+        vector<int> outliers =
+            findOutlierViews(viewErrors, state.rejectThreshold);
+        if (outliers.empty()) {
+            break;
+        }
+        if (active.size() - outliers.size() < 5) {
+            cout << "not rejecting " << outliers.size()
+                 << " bad views, less than 5 views would be left" << endl;
+            break;
+        }
+
+        // - report and drop them, the next round starts from this solution
+        cout << "rejecting " << outliers.size() << " views above "
+             << state.rejectThreshold << " pixels (rms " << error << "):"
+             << endl;
+        for (int k = outliers.size() - 1; k >= 0; k--) {
+            int i = outliers.at(k);
+            ViewError &viewError = viewErrors.at(i);
+            cout << "  " << imageNames.at(active.at(i)) << " rms "
+                 << viewError.rms << ", corner " << viewError.worstCorner
+                 << " off by " << viewError.maxError << endl;
+            active.erase(active.begin() + i);
+            rotationVecs.erase(rotationVecs.begin() + i);
+            translVecs.erase(translVecs.begin() + i);
+        }
+        flags = cv::CALIB_USE_INTRINSIC_GUESS;
+    }
 
-    // 3. get the projection matrix and record the error
-    double error = cv::calibrateCamera(listWorldPoints, listImagePoints,
-                                       srcFrame.size(), calibMatrix,
-                                       distortCoeff, rotationVecs, translVecs);
+    // - keep the solution for the next calibration, by view index
+    int numViews = listImagePoints.size();
+    state.calibMatrix = calibMatrix;
+    state.distortCoeff = distortCoeff;
+    state.rotationVecs.assign(numViews, cv::Mat());
+    state.translVecs.assign(numViews, cv::Mat());
+    state.viewErrors.assign(numViews, -1);
+    state.rejected.assign(numViews, true);
+    for (int i = 0; i < active.size(); i++) {
+        state.rotationVecs.at(active.at(i)) = rotationVecs.at(i);
+        state.translVecs.at(active.at(i)) = translVecs.at(i);
+        state.viewErrors.at(active.at(i)) = viewErrors.at(i).rms;
+        state.rejected.at(active.at(i)) = false;
+    }
+    state.imageSize = srcFrame.size();
+    state.error = error;
+    state.datasetHash = datasetHash;
 
     cout << "\n=====Calibration result:" << endl;
     cv::Ptr<cv::Formatter> formatMat =
@@ -398,24 +593,31 @@ void calibrating(cv::Mat srcFrame, vector<vector<cv::Point3f>> &listWorldPoints,
 
     // 4. Write to csv
     // - intrinsic
-    char distortCalibCsv[] = "res/distortionCalibMatrix.csv";
     cout << "\n- saving distortion coeff and camera matrix to "
          << string(distortCalibCsv) << endl;
-    appendDistortionCalibMatrix(distortCoeff, calibMatrix, distortCalibCsv, 1);
+    {
+        std::lock_guard<std::mutex> guard(calibFilesLock);
+        appendDistortionCalibMatrix(distortCoeff, calibMatrix, distortCalibCsv,
+                                    1);
+        appendDatasetHash(datasetHash, distortCalibCsv);
+    }
 
     // - extrinsic
     char rtCsv[] = "res/rt.csv";
     cout << "-saving rotation and translation matrix to " << string(rtCsv)
          << endl;
 
-    // -- overwrite at first
-    appendRotationTranslationVector(rotationVecs.at(0), translVecs.at(0),
-                                    imageNames.at(0), rtCsv, 1);
-
-    for (int i = 1; i < rotationVecs.size(); i++) {
-        // -- append to csv
-        appendRotationTranslationVector(rotationVecs.at(i), translVecs.at(i),
-                                        imageNames.at(i), rtCsv, 0);
+    // -- all views in one pass, optionally off the calling thread
+    vector<string> names;
+    for (int i = 0; i < active.size(); i++) {
+        names.push_back(imageNames.at(active.at(i)));
+    }
+    extrinsicsExport.wait();
+    if (state.backgroundExport) {
+        extrinsicsExport.thread = std::thread(writeExtrinsics, string(rtCsv),
+                                              rotationVecs, translVecs, names);
+    } else {
+        writeExtrinsics(rtCsv, rotationVecs, translVecs, names);
     }
 }
 
@@ -434,35 +636,30 @@ void readCalibDistorCoeffFromCSV(char *src_csv, cv::Mat &calibMatrix,
     calibMatrix = cv::Mat::zeros(3, 3, CV_64FC1);   // 3X3 matrix
     distortCoeff = cv::Mat::zeros(1, 5, CV_64FC1);  // 1X5 matrix
 
-    FILE *fp;
-    char img_file[256];
-
-    fp = fopen(src_csv, "r");
-    if (!fp) {
+    std::lock_guard<std::mutex> guard(calibFilesLock);
+    CsvReader reader;
+    if (!reader.open(src_csv)) {
         printf("Unable to open file\n");
+        return;
     }
 
     printf("\n>>>>>> Reading calibration matrix and coef %s\n", src_csv);
 
     // 1. calibration matrix
-    getstring(fp, img_file);           // read "calibMatrix"
+    string name;
+    reader.readString(name);           // read "calibMatrix"
     for (int i = 0; i < 3; i++) {      // row
         for (int j = 0; j < 3; j++) {  // col
-            float fval;
-            float eol = getfloat(fp, &fval);
-            calibMatrix.at<double>(i, j) = fval;
+            reader.readDouble(&calibMatrix.at<double>(i, j));
         }
     }
 
     // 2. distortion coeff
-    getstring(fp, img_file);
+    reader.readString(name);
     for (int j = 0; j < 5; j++) {  // cols
-        float fval;
-        float eol = getfloat(fp, &fval);
-        distortCoeff.at<double>(0, j) = fval;
+        reader.readDouble(&distortCoeff.at<double>(0, j));
     }
 
-    fclose(fp);
     printf("Finished reading CSV file\n");
 }
 
@@ -483,12 +680,7 @@ bool getCameraPosition(cv::Size chessboardSize,
         // - create world points if it doesnt exist yet
         if (worldPoints.size() == 0) {
             cout << "2. create the first world points" << endl;
-            for (int i = 0; i < chessboardSize.height; i++) {
-                for (int j = 0; j < chessboardSize.width; j++) {
-                    worldPoints.push_back(
-                        cv::Point3f((float)j * 1.0, (float)i * -1.0, 0));
-                }
-            }
+            createWorldPoints(chessboardSize, worldPoints);
         }
 
         rotVec = cv::Mat(3, 1, cv::DataType<double>::type);
@@ -589,11 +781,8 @@ int read2d3DVectorsFromCSV(char *src_csv, cv::Size chessboardSize,
                            vector<vector<cv::Point2f>> &listImagePoints,
                            vector<vector<cv::Point3f>> &listWorldPoints,
                            std::vector<char *> &imageNames, int echo_file) {
-    FILE *fp;
-    char img_file[256];
-
-    fp = fopen(src_csv, "r");
-    if (!fp) {
+    CsvReader reader;
+    if (!reader.open(src_csv)) {
         printf(
             "Unable to open calibration file. You might not have start "
             "calibrating yet\n");
@@ -604,137 +793,120 @@ int read2d3DVectorsFromCSV(char *src_csv, cv::Size chessboardSize,
     int numPoints = chessboardSize.width * chessboardSize.height;
 
     // 1. get the 2D vector and 3D vector of 1 image
-    int xImage = 0;
+    string img_file;
     for (;;) {
-        xImage += 1;
         vector<cv::Point3f> singleImage3f;  // Point3f vector of a single image
         vector<cv::Point2f> singleImage2f;  // Point2f vector of a single image
+        singleImage3f.reserve(numPoints);
+        singleImage2f.reserve(numPoints);
 
         // 2. read the image name
-        if (getstring(fp, img_file)) {
+        if (reader.readString(img_file)) {
             break;
         }
 
         // 3. save the image name to vector
-        char *fname = new char[strlen(img_file) + 1];
-        strcpy(fname, img_file);
+        char *fname = new char[img_file.size() + 1];
+        strcpy(fname, img_file.c_str());
         imageNames.push_back(fname);
 
         // 4. for 54 times (in one image) get 2D
         cv::Point2f imagePoint;
         for (int i = 0; i < numPoints; i++) {
-            // cout << "imagePoint" << i << "=";
-            float fval;
-
-            // 4. get the value and check if its end of the line
-            getfloat(fp, &fval);
-            imagePoint.x = fval;
-
-            getfloat(fp, &fval);
-            imagePoint.y = fval;
-
-            // 5. create 3D point and push to single vector
-            singleImage2f.push_back(cv::Point2f(imagePoint.x, imagePoint.y));
+            reader.readFloat(&imagePoint.x);
+            reader.readFloat(&imagePoint.y);
+            singleImage2f.push_back(imagePoint);
         }
 
         // push to the list of vector
         listImagePoints.push_back(singleImage2f);
 
         // 5. for 54 times get 3D
-        // cout << "\n>>>> printing world points " << endl;
         cv::Point3f worldPoint;
         for (int i = 0; i < numPoints; i++) {
-            float fval;
-            // - get the value and check if its end of the line
-            getfloat(fp, &fval);
-            worldPoint.x = fval;
-
-            getfloat(fp, &fval);
-            worldPoint.y = fval;
-
-            getfloat(fp, &fval);
-            worldPoint.z = fval;
-
-            // 7. push to single vector
-            singleImage3f.push_back(
-                cv::Point3f(worldPoint.x, worldPoint.y, worldPoint.z));
+            reader.readFloat(&worldPoint.x);
+            reader.readFloat(&worldPoint.y);
+            reader.readFloat(&worldPoint.z);
+            singleImage3f.push_back(worldPoint);
         }
         listWorldPoints.push_back(singleImage3f);
 
     }  // end of loop of image
 
-    fclose(fp);
     printf("Finished reading CSV file\n");
     return (0);
 }
 
 // Extension 1
-void readObjFile(const std::string &file_path,
-                 std::vector<cv::Point3f> &vertices,
-                 std::vector<std::vector<int>> &faces) {
-    // try read
-    std::ifstream file(file_path);
-    if (!file.good()) {
-        std::cout << "file does not exists" << std::endl;
-        exit(-1);
+void drawVirtualObjectOnChessboard(cv::Mat &srcFrame, cv::Mat &rotVec,
+                                   cv::Mat &transVec, cv::Mat &calibMatrix,
+                                   cv::Mat &distortCoeff, const Mesh &object,
+                                   cv::Mat &dstFrame, bool filled) {
+    if (object.vertices.empty()) {
+        return;
     }
 
-    // start reading
-    std::vector<std::string> values;
-    std::string line;
-    while (std::getline(file, line)) {
-        values.clear();
+    // 1. level of detail for the size of the bounding sphere in the image,
+    // the full mesh when the camera is inside it
+    vector<cv::Vec3f> center;
+    transformVertices({object.center}, rotVec, transVec, center);
+    double depth = center.at(0)[2];
+    double radius = depth > object.radius
+                        ? calibMatrix.at<double>(0, 0) * object.radius / depth
+                        : HUGE_VAL;
+    const Mesh &mesh = chooseLod(object, radius);
+
+    if (filled) {
+        rasterizeMesh(mesh, rotVec, transVec, calibMatrix, distortCoeff,
+                      cv::Scalar(0, 255, 0), dstFrame);
+        return;
+    }
 
-        std::stringstream ss(line);
+    // 2. vertices in camera coordinates and in the image
+    vector<cv::Vec3f> camera;
+    transformVertices(mesh.vertices, rotVec, transVec, camera);
+    vector<cv::Point2f> points2D;
+    cv::projectPoints(mesh.vertices, rotVec, transVec, calibMatrix,
+                      distortCoeff, points2D);
+
+    // 3. which side of the view frustum each vertex is out of
+    enum { behind = 1, left = 2, right = 4, above = 8, below = 16 };
+    int numVertices = mesh.vertices.size();
+    vector<unsigned char> outside(numVertices, 0);
+    for (int i = 0; i < numVertices; i++) {
+        const cv::Point2f &p = points2D.at(i);
+        outside.at(i) = (camera.at(i)[2] <= 0 ? behind : 0) |
+                        (p.x < 0 ? left : 0) |
+                        (p.x >= dstFrame.cols ? right : 0) |
+                        (p.y < 0 ? above : 0) |
+                        (p.y >= dstFrame.rows ? below : 0);
+    }
 
-        // split line
-        while (ss.good()) {
-            std::string substr;
-            std::getline(ss, substr, ' ');
-            if (!substr.empty()) values.push_back(substr);
+    // 4. triangles turned to the camera, only a closed mesh hides its back
+    int numTriangles = mesh.triangles.size();
+    vector<unsigned char> facing(numTriangles, 1);
+    if (mesh.closed) {
+        for (int f = 0; f < numTriangles; f++) {
+            const cv::Vec3i &t = mesh.triangles.at(f);
+            const cv::Vec3f &c0 = camera.at(t[0]);
+            cv::Vec3f normal =
+                (camera.at(t[1]) - c0).cross(camera.at(t[2]) - c0);
+            facing.at(f) = normal.dot(c0) < 0;
         }
+    }
 
-        if (values.empty()) {
+    // 5. draw every edge once, if it is in the image and one of its
+    // triangles faces the camera
+    for (const MeshEdge &edge : mesh.edges) {
+        unsigned char a = outside.at(edge.v[0]), b = outside.at(edge.v[1]);
+        if (((a | b) & behind) || (a & b)) {
             continue;
         }
-
-        if (values.at(0) == "v") {
-            float x = stof(values.at(1));
-            float y = stof(values.at(2));
-            float z = stof(values.at(3));
-
-            vertices.push_back(cv::Point3f(x + 5, y - 5, z + 5));
-
-        } else if (values.at(0) == "f") {
-            faces.push_back({std::stoi(values.at(1)), std::stoi(values.at(2)),
-                             std::stoi(values.at(3))});
+        if (!facing.at(edge.faces[0]) &&
+            (edge.faces[1] < 0 || !facing.at(edge.faces[1]))) {
+            continue;
         }
-    }
-}
-
-void drawVirtualObjectOnChessboard(cv::Mat &srcFrame, cv::Mat &rotVec,
-                                   cv::Mat &transVec, cv::Mat &calibMatrix,
-                                   cv::Mat &distortCoeff,
-                                   vector<cv::Point3f> &vertices,
-                                   vector<vector<int>> &faces,
-                                   cv::Mat &dstFrame) {
-    // result 2D points
-    vector<cv::Point2f> points2D;
-
-    cv::projectPoints(vertices, rotVec, transVec, calibMatrix, distortCoeff,
-                      points2D);
-
-    // draw3DAxesOnChessboard(dstFrame, calibMatrix, distortCoeff, rotVec,
-    //                        transVec);
-
-    for (std::vector<int> &face : faces) {
-        cv::line(dstFrame, points2D[face[0] - 1], points2D[face[1] - 1],
-                 cv::Scalar(0, 255, 0), 1);
-
-        cv::line(dstFrame, points2D[face[1] - 1], points2D[face[2] - 1],
-                 cv::Scalar(0, 255, 0), 1);
-
-        cv::line(dstFrame, points2D[face[2] - 1], points2D[face[0] - 1],
+        cv::line(dstFrame, points2D.at(edge.v[0]), points2D.at(edge.v[1]),
                  cv::Scalar(0, 255, 0), 1);
     }
 }
@@ -759,76 +931,68 @@ int getIndex(vector<int> v, int K) {
 
 void projectMovieOnChessboard(cv::Mat &srcFrame, cv::Mat &rotVec,
                               cv::Mat &transVec, cv::Mat &calibMatrix,
-                              cv::Mat &distortCoeff, cv::Mat &movieFrame,
-                              cv::Mat &dstFrame) {
+                              cv::Mat &distortCoeff, MipPyramid &movie,
+                              cv::Mat &dstFrame, const cv::Mat &undistortMap) {
     cout << "project movie on chessboard " << endl;
-    // 1. Get movie corner points (2D)
-    std::vector<cv::Point> pts_movie;
-    pts_movie.push_back(cv::Point(0, 0));                // top left
-    pts_movie.push_back(cv::Point(movieFrame.cols, 0));  // top right
-    pts_movie.push_back(
-        cv::Point(movieFrame.cols, movieFrame.rows));    // bottom right
-    pts_movie.push_back(cv::Point(0, movieFrame.rows));  // bottom left
-
-    // 2. Get Chessboard corner points 2D
-    // - Get chessboard 3D points
-    vector<cv::Point3f> vec3D;
-    vec3D.push_back(cv::Point3f(-7, 5, 0));
-    vec3D.push_back(cv::Point3f(15, 5, 0));
-    vec3D.push_back(cv::Point3f(15, -11, 0));
-    vec3D.push_back(cv::Point3f(-7, -11, 0));
-
-    // - Project to 2D points
-    vector<cv::Point2f> pts_dst_float;
-    cv::projectPoints(vec3D, rotVec, transVec, calibMatrix, distortCoeff,
-                      pts_dst_float);
-
-    vector<cv::Point> pts_dst(pts_dst_float.begin(), pts_dst_float.end());
-
-        // 3. if chessboard 2D points > 0
-        if (pts_dst.size() > 0) {
-        // 4. Find homography between the two frames
-        cv::Mat h = cv::findHomography(pts_movie, pts_dst);
-
-        // 5. Warped the movie frame
-        cv::Mat warpedMovFrame;  // output
-        cv::warpPerspective(movieFrame, warpedMovFrame, h, srcFrame.size(),
-                            cv::INTER_LINEAR);
-
-        // 6. Prepare a mask representing region to copy from the warped
-        // movie image into the original frame.
-        cv::Mat mask = cv::Mat::zeros(srcFrame.rows, srcFrame.cols, CV_8UC1);
-
-        // color the mask white on the Aruco area
-        cv::fillConvexPoly(mask, pts_dst, cv::Scalar(255, 255, 255),
-                           cv::LINE_AA);
-
-        // 7. Erode the mask to not copy the boundary effects from the
-        // warping
-        cv::Mat element =
-            cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
-        cv::erode(mask, mask, element);
-
-        // 8. Copy the masked warped image into the srcFrame in the
-        // mask region.
-        cv::Mat srcWithMovie = srcFrame.clone();
-        warpedMovFrame.copyTo(srcWithMovie, mask);
+    cv::Size movieSize = movie.size();
+    if (movieSize.area() == 0) {
+        return;
+    }
 
-        // 9. output
-        srcWithMovie.copyTo(dstFrame);
+    // 1. Movie corners go on the chessboard plane at (-7, 5), (15, 5),
+    // (15, -11) and (-7, -11)
+    cv::Matx33d planeFromMovie(22.0 / movieSize.width, 0, -7, 0,
+                               -16.0 / movieSize.height, 5, 0, 0, 1);
+
+    // 2. Homography between the two frames straight from the pose
+    cv::Matx33d h =
+        planeHomography(calibMatrix, rotVec, transVec, planeFromMovie);
+
+    // 3. With distortion correction, the part of the frame the curved
+    // outline of the movie covers
+    cv::Rect bounds;
+    if (!undistortMap.empty()) {
+        vector<cv::Point3f> outline;
+        for (int i = 0; i <= 8; i++) {
+            float f = i / 8.0f;
+            outline.push_back(cv::Point3f(-7 + 22 * f, 5, 0));
+            outline.push_back(cv::Point3f(-7 + 22 * f, -11, 0));
+            outline.push_back(cv::Point3f(-7, 5 - 16 * f, 0));
+            outline.push_back(cv::Point3f(15, 5 - 16 * f, 0));
+        }
+        vector<cv::Point2f> outline2D;
+        cv::projectPoints(outline, rotVec, transVec, calibMatrix,
+                          distortCoeff, outline2D);
+        // points far outside the frame (or behind the camera) would
+        // overflow the int rectangle, keep them on the frame
+        float maxX = (float)(srcFrame.cols - 1);
+        float maxY = (float)(srcFrame.rows - 1);
+        for (cv::Point2f &p : outline2D) {
+            p.x = std::max(0.0f, std::min(p.x, maxX));
+            p.y = std::max(0.0f, std::min(p.y, maxY));
+        }
+        bounds = cv::boundingRect(outline2D);
+        bounds.width++;
+        bounds.height++;
     }
+
+    // 4. Warp the movie frame straight into the output, inside the
+    // bounding rectangle of the chessboard only
+    srcFrame.copyTo(dstFrame);
+    compositeQuad(movie, h, dstFrame, undistortMap, bounds);
 }
 
-void createMovieOnAruco(cv::Mat &srcFrame, cv::Mat &movieFrame,
+void createMovieOnAruco(cv::Mat &srcFrame, MipPyramid &movie,
                         cv::Mat &dstFrame) {
+    cv::Size movieSize = movie.size();
     // 1. get movie corner points (src)
     // movieFrame = cv::imread("res/duck.png");
     std::vector<cv::Point> pts_movie;
     pts_movie.push_back(cv::Point(0, 0));                // top left
-    pts_movie.push_back(cv::Point(movieFrame.cols, 0));  // top right
+    pts_movie.push_back(cv::Point(movieSize.width, 0));  // top right
     pts_movie.push_back(
-        cv::Point(movieFrame.cols, movieFrame.rows));    // bottom right
-    pts_movie.push_back(cv::Point(0, movieFrame.rows));  // bottom left
+        cv::Point(movieSize.width, movieSize.height));    // bottom right
+    pts_movie.push_back(cv::Point(0, movieSize.height));  // bottom left
 
     // 2. get aruco corner points
     // - set variables
@@ -843,7 +1007,6 @@ void createMovieOnAruco(cv::Mat &srcFrame, cv::Mat &movieFrame,
     cv::aruco::detectMarkers(srcFrame, dictionary, markerCorners, markerIds,
                              parameters, rejectedCandidates);
     // cv::aruco::drawDetectedMarkers(srcFrame, markerCorners, markerIds);
-    srcFrame.copyTo(dstFrame);
 
     // - save the corners we want to map it into
     std::vector<cv::Point> pts_dst;
@@ -862,42 +1025,28 @@ void createMovieOnAruco(cv::Mat &srcFrame, cv::Mat &movieFrame,
 
         // 4. Find homography between the two frames
         cv::Mat h = cv::findHomography(pts_movie, pts_dst);
+        if (h.empty()) {
+            srcFrame.copyTo(dstFrame);
+            return;
+        }
 
-        // 5. Warped the movie frame
-        cv::Mat warpedMovFrame;  // output
-        cv::warpPerspective(movieFrame, warpedMovFrame, h, srcFrame.size(),
-                            cv::INTER_LINEAR);
-        // warpedMovFrame.copyTo(dstFrame);
-
-        // 6. Prepare a mask representing region to copy from the warped
-        // movie image into the original frame.
-        cv::Mat mask = cv::Mat::zeros(srcFrame.rows, srcFrame.cols, CV_8UC1);
-
-        // color the mask white on the Aruco area
-        cv::fillConvexPoly(mask, pts_dst, cv::Scalar(255, 255, 255),
-                           cv::LINE_AA);
-
-        // 7. Erode the mask to not copy the boundary effects from the
-        // warping
-        cv::Mat element =
-            cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
-        cv::erode(mask, mask, element);
-
-        // 8. Copy the masked warped image into the srcFrame in the
-        // mask region.
-        cv::Mat srcWithMovie = srcFrame.clone();
-        warpedMovFrame.copyTo(srcWithMovie, mask);
-
-        // 9. output
-        // draw circle on src frame
+        // 5. output is the frame next to the frame with the movie, the
+        // movie is warped straight into the right half, inside the bounding
+        // rectangle of the markers only
+        dstFrame.create(srcFrame.rows, srcFrame.cols * 2, srcFrame.type());
+        cv::Mat left = dstFrame(cv::Rect(0, 0, srcFrame.cols, srcFrame.rows));
+        cv::Mat right =
+            dstFrame(cv::Rect(srcFrame.cols, 0, srcFrame.cols, srcFrame.rows));
+        srcFrame.copyTo(right);
+        compositeQuad(movie, h, right);
+
+        // 6. draw circle on src frame
         for (int i = 0; i < pts_dst.size(); i++) {
             cv::circle(srcFrame, pts_dst.at(i), 5, cv::Scalar(0, 255, 255), 2,
                        8, 0);
         }
-
-        // concatenate output
-        cv::Mat concatenatedOutput;
-        cv::hconcat(srcFrame, srcWithMovie, concatenatedOutput);
-        concatenatedOutput.copyTo(dstFrame);
+        srcFrame.copyTo(left);
+    } else {
+        srcFrame.copyTo(dstFrame);
     }
 }
\ No newline at end of file
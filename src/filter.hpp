@@ -13,6 +13,10 @@
 
 #include <opencv2/opencv.hpp>
 #include <vector>
+
+#include "mesh.hpp"
+#include "overlay.hpp"
+#include "raster.hpp"
 using namespace std;
 
 
@@ -43,6 +47,19 @@ int read2d3DVectorsFromCSV(char *src_csv, cv::Size chessboardSize,
                            vector<vector<cv::Point3f>> &listWorldPoints,
                            std::vector<char *> &imageNames, int echo_file);
 
+/**
+ * @brief Task 1: Find the chessboard corners of an image with subpixel
+ * accuracy, without drawing anything. Safe to call from several threads.
+ *
+ * @param src the source image
+ * @param outputImagePoints the corners found, empty if there is no chessboard
+ * @param chessboardSize the width and height cell of the chessboard
+ * @param fastCheck true to quickly reject images that have no chessboard
+ * @return true if the whole chessboard was found
+ */
+bool findChessboard(cv::Mat &src, vector<cv::Point2f> &outputImagePoints,
+                    cv::Size chessboardSize, bool fastCheck);
+
 /*
  * Task 1: Given an image source, find a chessboard pattern and draw points on
  * the chessboard. Save this corner points as a vector in imagePoints vector
@@ -54,6 +71,16 @@ int read2d3DVectorsFromCSV(char *src_csv, cv::Size chessboardSize,
 void drawOnChessboard(cv::Mat &src, cv::Mat &dst,
                       std::vector<cv::Point2f> &imagePoints,
                       cv::Size chessboardSize);
+/**
+ * @brief Task 2: Create the 3D world points of every corner of the chessboard.
+ * One square is one unit, x goes right and y goes down (negative).
+ *
+ * @param chessboardSize the row col of the chessboard
+ * @param worldPoints the output 3D points, appended to
+ */
+void createWorldPoints(cv::Size chessboardSize,
+                       vector<cv::Point3f> &worldPoints);
+
 /**
  * @brief Task 2: Will save an image as png to the res folder
  *
@@ -63,6 +90,21 @@ void drawOnChessboard(cv::Mat &src, cv::Mat &dst,
  */
 string saveImage(cv::Mat frame, string imgPrefix);
 
+/**
+ * @brief Task 2: Append one view (image name, 2D points, 3D points) as a row
+ * of a csv file. The file is kept open between calls.
+ *
+ * @param v2 the 2d points
+ * @param v3 the 3d points
+ * @param csvfilepath the file to save these points to
+ * @param image_filename the image file name
+ * @param reset_file true to overwrite the file instead of appending
+ * @return int 0 if successful
+ */
+int appendPointVectorsToCsv(vector<cv::Point2f> &v2, vector<cv::Point3f> &v3,
+                            char *csvfilepath, const char *image_filename,
+                            int reset_file);
+
 /**
  * @brief Task 2: For the purpose of calibration, this function
  * will save the image 2D points of the chessboard and its projection in world
@@ -85,6 +127,59 @@ void savePointsCsvVector(cv::Size chessboardSize,
                          vector<vector<cv::Point3f>> &listWorldPoints,
                          char *imgName, std::vector<char *> &imageNames);
 
+/**
+ * @brief The solver used by calibrating: OpenCV's calibrateCamera, or the
+ * sparse bundle adjustment of bundle.hpp for very large numbers of views.
+ */
+enum CalibEngine { engineOpenCV, engineBundle };
+
+/**
+ * @brief The running calibration solution. It is kept between calibrations so
+ * that newly saved views can be added to the previous solution instead of
+ * solving everything again from scratch.
+ */
+struct CalibrationState {
+    cv::Mat calibMatrix;           // 3X3 matrix
+    cv::Mat distortCoeff;          // 1X5 matrix
+    vector<cv::Mat> rotationVecs;  // extrinsic of every view, by view index
+    vector<cv::Mat> translVecs;
+    vector<double> viewErrors;  // rms reprojection error of every view
+    vector<bool> rejected;      // views left out as outliers, empty pose
+    cv::Size imageSize;
+    double error = 0;  // rms reprojection error of the last solve
+    CalibEngine engine = engineOpenCV;
+    double rejectThreshold = 0;  // view rms in pixels, 0 keeps every view
+    unsigned long long datasetHash = 0;  // hashCalibrationDataset of the solve
+    bool backgroundExport = true;  // write res/rt.csv on its own thread
+};
+
+/**
+ * @brief Hash of everything a calibration depends on: every image and world
+ * point, the image size and the engine and rejection settings of the
+ * state. The points are hashed at the precision res/imageWorldPoints.csv
+ * stores them with, so views captured live and the same views loaded back
+ * give the same hash. The hash is never 0.
+ *
+ * @param listWorldPoints the list of 3D points of the chessboard
+ * @param listImagePoints the list of 2D points of the chessboard
+ * @param imageSize the size of the calibration images
+ * @param state the settings of the calibration
+ * @return unsigned long long the hash
+ */
+unsigned long long hashCalibrationDataset(
+    vector<vector<cv::Point3f>> &listWorldPoints,
+    vector<vector<cv::Point2f>> &listImagePoints, cv::Size imageSize,
+    CalibrationState &state);
+
+/**
+ * @brief Read the hash of the dataset that the intrinsics csv file was
+ * calibrated from.
+ *
+ * @param src_csv the intrinsics csv file
+ * @return unsigned long long the hash, 0 if the file or the hash is missing
+ */
+unsigned long long readDatasetHashFromCSV(char *src_csv);
+
 /**
  * @brief Task 3. Given a list of world and image points this function
  * will save the intrinsic matrices: distortion cofficient and camera matrix to
@@ -101,6 +196,35 @@ void calibrating(cv::Mat srcFrame, vector<vector<cv::Point3f>> &listWorldPoints,
                  vector<vector<cv::Point2f>> &listImagePoints,
                  std::vector<char *> &imageNames);
 
+/**
+ * @brief Incremental version of calibrating. If the state already holds a
+ * solution for the same image size, the solve warm-starts from its camera
+ * matrix and distortion coefficient (CALIB_USE_INTRINSIC_GUESS) and only runs
+ * a short refinement. Otherwise, or when fullSolve is set, all views are
+ * solved from scratch. The per-view extrinsics are stored in the state too;
+ * the bundle engine also starts from them, so only the new views need an
+ * initial pose.
+ *
+ * After every solve the reprojection error of every view is measured. If
+ * state.rejectThreshold is set, views above it (and well above the median
+ * view) are reported by name with their worst corner, left out, and the
+ * rest is solved again.
+ *
+ * Unless fullSolve is set, nothing is solved when the dataset hash matches
+ * the state or the hash saved with res/distortionCalibMatrix.csv.
+ *
+ * @param srcFrame the image to calibrate the camera
+ * @param listWorldPoints the list of 3D points of the chessboard
+ * @param listImagePoints the list of 2D points of the chessboard
+ * @param imageNames the names of the images of every view
+ * @param state the running solution, updated with the new result
+ * @param fullSolve true to ignore the previous solution
+ */
+void calibrating(cv::Mat srcFrame, vector<vector<cv::Point3f>> &listWorldPoints,
+                 vector<vector<cv::Point2f>> &listImagePoints,
+                 std::vector<char *> &imageNames, CalibrationState &state,
+                 bool fullSolve);
+
 /**
  * @brief Task 4. Given position of chessboard in 2D and 3D,
  * this function will print rotation and translation vectors.
@@ -154,10 +278,6 @@ void drawPolygonOnChessboard(cv::Mat &srcFrame, cv::Mat &calibMatrix,
 
 
 // Extension 1
-void readObjFile(const std::string &file_path, std::vector<cv::Point3f> &vertices,
-              std::vector<std::vector<int>> &faces);
-
-
 /**
  * @brief draw virtual object from obj file on a chessboard
  * 
@@ -166,29 +286,44 @@ void readObjFile(const std::string &file_path, std::vector<cv::Point3f> &vertice
  * @param tvec the input translation vector
  * @param calibMatrix 
  * @param distortCoeff 
- * @param vertices 
- * @param faces 
+ * @param mesh the triangles of the object, drawn at the level of detail
+ * that fits its size in the image
+ * @param filled true for shaded triangles with hidden surfaces removed, false
+ * for the wireframe
  */
 void drawVirtualObjectOnChessboard(cv::Mat &srcFrame, cv::Mat &rvec,
                                    cv::Mat &tvec, cv::Mat &calibMatrix,
-                                   cv::Mat &distortCoeff,
-                                   vector<cv::Point3f> &vertices,
-                                   vector<vector<int>> &faces,
-                                   cv::Mat &dstFrame);
+                                   cv::Mat &distortCoeff, const Mesh &mesh,
+                                   cv::Mat &dstFrame, bool filled = false);
 
 // Extension 2
 /** 
  * @brief Project a movie on image that has aruco marker on them
  * 
  * @param srcFrame the input original frame without modification
- * @param movieFrame the input movie frame we want to project to the original image
+ * @param movie the mip pyramid of the movie frame we want to project to the
+ * original image, the level is picked from the size of the markers
  * @param dstFrame the output modified image
  */
-void createMovieOnAruco(cv::Mat &srcFrame, cv::Mat &movieFrame, cv::Mat &dstFrame);
+void createMovieOnAruco(cv::Mat &srcFrame, MipPyramid &movie, cv::Mat &dstFrame);
 
+/**
+ * @brief Project a movie on the plane of the chessboard
+ *
+ * @param srcFrame the input original frame without modification
+ * @param rotVec the rotation vector of the chessboard
+ * @param transVec the translation vector of the chessboard
+ * @param calibMatrix the calibration matrix
+ * @param distortCoeff the distortion coefficient
+ * @param movie the mip pyramid of the movie frame
+ * @param dstFrame the output modified image
+ * @param undistortMap optional, to bend the movie with the lens distortion
+ * (see buildUndistortMap)
+ */
 void projectMovieOnChessboard(cv::Mat &srcFrame, cv::Mat &rotVec,
                               cv::Mat &transVec, cv::Mat &calibMatrix,
-                              cv::Mat &distortCoeff, cv::Mat &movieFrame,
-                              cv::Mat &dstFrame);
+                              cv::Mat &distortCoeff, MipPyramid &movie,
+                              cv::Mat &dstFrame,
+                              const cv::Mat &undistortMap = cv::Mat());
 
 #endif
\ No newline at end of file
@@ -1,13 +1,25 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <opencv2/aruco.hpp>
 #include <vector>
 
+#include "assets.hpp"
+#include "bench.hpp"
+#include "bootstrap.hpp"
+#include "calibworker.hpp"
+#include "dataset.hpp"
 #include "filter.hpp"
+#include "offline.hpp"
+#include "reprojection.hpp"
+#include "shm.hpp"
+#include "viewselect.hpp"
 #include "opencv2/calib3d.hpp"
 #include "opencv2/features2d.hpp"
 #include "opencv2/features2d/features2d.hpp"
@@ -22,6 +34,7 @@ enum filter {
     opDrawOnChessboard,
     opSaveImageWorldPoints,
     opCalibrate,
+    opFullCalibrate,
     opSaveImage,
     opCameraPosition,
     op3DAxes,
@@ -32,25 +45,105 @@ enum filter {
     opVirtualObj
 };
 
-int videoMode() {
+// frames kept in each shared memory frame ring
+static const uint32_t FRAME_RING_SLOTS = 4;
+
+// the widest frame shown is the aruco view, the movie next to the camera
+static const int MAX_OUTPUT_WIDTH_FACTOR = 2;
+
+// a frame that does not fit its ring is reported once every this many
+static const uint64_t DROP_REPORT_INTERVAL = 1000;
+
+/**
+ * @brief Publish a frame in a shared memory frame ring. The ring is created
+ * with the first frame, with slots of slotBytes. Frames that do not fit are
+ * counted in dropped and reported.
+ */
+static void publishFrame(FrameRingWriter &ring, const char *name,
+                         const cv::Mat &frame, size_t slotBytes,
+                         uint64_t frameId, uint64_t captureNs,
+                         uint64_t &dropped) {
+    if (frame.empty()) {
+        return;
+    }
+    if (!ring.isOpen() &&
+        !ring.create(name, FRAME_RING_SLOTS, slotBytes)) {
+        return;
+    }
+    size_t rowBytes = frame.cols * frame.elemSize();
+    FrameInfo info;
+    info.frameId = frameId;
+    info.timestampNs = captureNs;
+    info.width = frame.cols;
+    info.height = frame.rows;
+    info.type = frame.type();
+    info.step = rowBytes;
+    if (!ring.publish(info, frame.data, frame.step)) {
+        if (dropped++ % DROP_REPORT_INTERVAL == 0) {
+            printf("%d x %d frame too large for %s, %llu frames dropped\n",
+                   frame.cols, frame.rows, name,
+                   (unsigned long long)dropped);
+        }
+    }
+}
+
+// memory a movie may take when it is decoded into memory, longer movies are
+// streamed. --movie-cache changes it
+static const size_t MOVIE_CACHE_BYTES = (size_t)128 << 20;
+
+/**
+ * @brief Parse a whole number in [0, maxValue] given on the command line
+ *
+ * @return false if the text is not a number or out of range
+ */
+static bool parseCount(const char *text, long maxValue, long &value) {
+    char *end;
+    errno = 0;
+    value = strtol(text, &end, 10);
+    return end != text && *end == '\0' && errno == 0 && value >= 0 &&
+           value <= maxValue;
+}
+
+/**
+ * @brief Live camera mode.
+ * usage: calib video [--movie-width <pixels>] [--movie-cache <MiB>]
+ * --movie-width is the width the cached movie frames are scaled down to, the
+ * camera width by default. --movie-cache is the memory one cached movie may
+ * take, 0 streams every movie.
+ */
+int videoMode(int argc, char *argv[]) {
     cv::VideoCapture *capdev;
-    cv::VideoCapture *capMovie;
     bool record = false;
+    int movieWidth = 0;
+    size_t movieCacheBytes = MOVIE_CACHE_BYTES;
+    bool validArgs = true;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        long value;
+        if (arg == "--movie-width") {
+            validArgs = parseCount(argv[i + 1], INT_MAX, value) && validArgs;
+            movieWidth = (int)value;
+        } else if (arg == "--movie-cache") {
+            // - MiB that still fit in a size_t once shifted to bytes
+            long maxMiB = (long)std::min<size_t>(LONG_MAX, SIZE_MAX >> 20);
+            validArgs = parseCount(argv[i + 1], maxMiB, value) && validArgs;
+            movieCacheBytes = (size_t)value << 20;
+        }
+    }
+    if (!validArgs) {
+        cout << "usage: calib video [--movie-width <pixels>]"
+             << " [--movie-cache <MiB>]" << endl;
+        return (-1);
+    }
 
-    // 2. create movie and real time video capture
+    // 2. create real time video capture, the movies are loaded below
     capdev = new cv::VideoCapture(0);
-    // capMovie = new cv::VideoCapture("res/sky.mp4");
 
     if (!capdev->isOpened()) {
         printf("Unable to open video device\n");
         return (-1);
     }
 
-    // if (!capMovie->isOpened()) {
-    //     cout << "Error opening video stream or file" << endl;
-    //     return -1;
-    // }
-
     capdev->set(cv::CAP_PROP_FRAME_WIDTH,
                 600);  // Setting the width of the video
     capdev->set(cv::CAP_PROP_FRAME_HEIGHT,
@@ -87,28 +180,106 @@ int videoMode() {
     // will stay empty if there is no previous data
     char src_csv[] = "res/imageWorldPoints.csv";
     vector<char *> imageNames;
-    read2d3DVectorsFromCSV(src_csv, chessboardSize, listImagePoints,
-                           listWorldPoints, imageNames, 0);
+    loadCalibrationViews(src_csv, chessboardSize, listImagePoints,
+                         listWorldPoints, imageNames);
+
+    // check the saved intrinsics were calibrated from these points
+    char distortCalibCsv[] = "res/distortionCalibMatrix.csv";
+    unsigned long long savedHash = readDatasetHashFromCSV(distortCalibCsv);
+    if (savedHash != 0) {
+        CalibrationState defaults;
+        if (savedHash != hashCalibrationDataset(listWorldPoints,
+                                                listImagePoints, refS,
+                                                defaults)) {
+            cout << "warning: " << distortCalibCsv
+                 << " was not calibrated from the current " << src_csv
+                 << ", press 'c' to calibrate again" << endl;
+        }
+    }
+
+    // calibrates in the background, 'c' only has to add the new views
+    CalibrationWorker calibWorker;
+    std::shared_ptr<const Intrinsics> liveIntrinsics;
+
+    // poses for other processes, see posereader
+    PoseRingWriter poseRing;
+    if (!poseRing.create(POSE_RING_NAME, 1024)) {
+        cout << "poses will not be published" << endl;
+    }
+    uint64_t frameId = 0;
+
+    // processed frames (and the camera frames after 'o') for other processes
+    FrameRingWriter frameRing;
+    FrameRingWriter sourceRing;
+    bool publishSource = false;
+    size_t sourceSlotBytes =
+        (size_t)refS.width * refS.height * CV_ELEM_SIZE(CV_8UC3);
+    size_t outputSlotBytes = MAX_OUTPUT_WIDTH_FACTOR * sourceSlotBytes;
+    uint64_t droppedOutput = 0, droppedSource = 0;
 
     cv::Mat calibMatrix;   // 3X3 matrix
     cv::Mat distortCoeff;  // 1X5 matrix
-    vector<cv::Point3f> vertices;
-    std::vector<std::vector<int>> faces;
+    // where the objects stand on the chessboard
+    const cv::Point3f objOffset(5, -5, 5);
+
+    // 1, 2, 3 switch between these objects and movies, all loaded in the
+    // background now so switching is instant
+    const vector<string> objFiles = {"res/shuttle.obj", "res/cow.obj",
+                                     "res/plane.obj"};
+    const vector<string> movFiles = {"res/space.mp4", "res/grass.mp4",
+                                     "res/sky.mp4", "res/dog.mp4"};
+    // short movies are decoded once, at no more than the camera resolution.
+    // The movie plane is wider than the chessboard, so it usually covers
+    // the frame and is drawn from the full size frames
+    MovieCacheSettings movieCache;
+    movieCache.frameSize = refS;
+    if (movieWidth > 0 && movieWidth < refS.width) {
+        movieCache.frameSize = cv::Size(
+            movieWidth, (int)((int64_t)refS.height * movieWidth / refS.width));
+    }
+    movieCache.maxBytes = movieCacheBytes;
+    AssetManager assets(objOffset, 4, movieCache);
+    assets.preload(objFiles, movFiles);
+
+    std::shared_ptr<const Mesh> mesh;
+    std::shared_ptr<MovieSource> movie;
+    MipPyramid moviePyramid;  // of movieFrame
+
+    // 'w' switches the objects between wireframe and shaded triangles
+    bool filledMesh = false;
+
+    // 'u' bends the movie with the lens distortion
+    bool undistortMovie = false;
+    cv::Mat undistortMap;  // for the current calibration
     string movFile;
 
         float x_shift;
     float y_shift;
-    // readObjFile("res/shuttle.obj", vertices, faces);
     char intInput;
     for (;;) {
         // 1. get a new frame from the camera, treat as a stream
         *capdev >> srcFrame;
+        uint64_t captureNs = monotonicNs();
+        frameId++;
 
         if (srcFrame.empty()) {
             printf("srcFrame is empty\n");
             break;
         }
 
+        // - pick up a calibration that finished in the background
+        std::shared_ptr<const Intrinsics> intrinsics = calibWorker.latest();
+        if (intrinsics && intrinsics != liveIntrinsics) {
+            liveIntrinsics = intrinsics;
+            // - own copies, the snapshot stays shared with the worker. The
+            // map is only read, it is shared
+            calibMatrix = intrinsics->calibMatrix.clone();
+            distortCoeff = intrinsics->distortCoeff.clone();
+            undistortMap = intrinsics->undistortMap;
+            cout << "using new calibration of " << intrinsics->numViews
+                 << " views, error: " << intrinsics->error << endl;
+        }
+
         // Record
         if (record == 1) {
             output.write(dstFrame);
@@ -144,15 +315,20 @@ int videoMode() {
             // just draw chessboard again don't save until user ask
             op = opDrawOnChessboard;
 
-        } else if (op == opCalibrate) {
+        } else if (op == opCalibrate || op == opFullCalibrate) {
             // 1. Not enough image
             if (listImagePoints.size() < 5 || listWorldPoints.size() < 5) {
                 cout << "you only have " << listImagePoints.size()
                      << " calibration images. Please add more" << endl;
 
-            } else {  // 2. Start calibrating
-                calibrating(srcFrame, listWorldPoints, listImagePoints,
-                            imageNames);
+            } else if (!calibWorker.request(srcFrame.size(), listWorldPoints,
+                                            listImagePoints, imageNames,
+                                            op == opFullCalibrate)) {
+                cout << "still calibrating, try again when it is done"
+                     << endl;
+            } else {  // 2. Started calibrating in the background
+                cout << "calibrating " << listImagePoints.size()
+                     << " views in the background" << endl;
             }
 
             srcFrame.copyTo(dstFrame);  // make sure video keep playing
@@ -168,6 +344,22 @@ int videoMode() {
             if (getCameraPosition(chessboardSize, worldPoints, imagePoints,
                                   calibMatrix, distortCoeff, rotVec,
                                   transVec)) {
+                // - publish
+                PoseRecord pose;
+                pose.frameId = frameId;
+                pose.timestampNs = captureNs;
+                for (int i = 0; i < 3; i++) {
+                    pose.rotVec[i] = rotVec.at<double>(i);
+                    pose.transVec[i] = transVec.at<double>(i);
+                }
+                pose.reprojError =
+                    poseReprojectionError(worldPoints, imagePoints,
+                                          calibMatrix, distortCoeff, rotVec,
+                                          transVec);
+                pose.cornerCount = imagePoints.size();
+                pose.reserved = 0;
+                poseRing.publish(pose);
+
                 // - print
                 cv::Ptr<cv::Formatter> formatMat =
                     cv::Formatter::get(cv::Formatter::FMT_DEFAULT);
@@ -293,12 +485,16 @@ int videoMode() {
         } else if (op == opDetectAruco) {
             // >> given a movie frame and frame with aruco corners, map movie to
             // the original srcFrame
-            *capMovie >> movieFrame;
-            if (movieFrame.empty()) {
-                capMovie = new cv::VideoCapture("res/dog.mp4");
-                *capMovie >> movieFrame;
+            if (movie) {
+                // - hand the previous frame back to the decoder first
+                movieFrame = movie->latest(captureNs);
+                moviePyramid.reset(movieFrame, movie->frameIndex());
+            }
+            if (!movieFrame.empty()) {
+                createMovieOnAruco(srcFrame, moviePyramid, dstFrame);
+            } else {
+                srcFrame.copyTo(dstFrame);
             }
-            createMovieOnAruco(srcFrame, movieFrame, dstFrame);
 
         } else if (op == opVirtualObj) {
         
@@ -316,20 +512,27 @@ int videoMode() {
                 // movie to
                 // the original srcFrame
 
-                *capMovie >> movieFrame;
-                if (movieFrame.empty()) {
-                    cout << "filling mov file" << endl;
-                    cout << movFile << endl;
-                    capMovie = new cv::VideoCapture(movFile);
-                    *capMovie >> movieFrame;
+                if (movie) {
+                    movieFrame = movie->latest(captureNs);
+                    moviePyramid.reset(movieFrame, movie->frameIndex());
+                }
+                // - the calibration loaded at startup has no map yet
+                if (undistortMovie && undistortMap.size() != srcFrame.size()) {
+                    buildUndistortMap(calibMatrix, distortCoeff,
+                                      srcFrame.size(), undistortMap);
+                }
+                if (!movieFrame.empty()) {
+                    projectMovieOnChessboard(
+                        srcFrame, rotVec, transVec, calibMatrix, distortCoeff,
+                        moviePyramid, dstFrame,
+                        undistortMovie ? undistortMap : cv::Mat());
                 }
-                // *capMovie >> movieFrame;
-                projectMovieOnChessboard(srcFrame, rotVec, transVec, calibMatrix, 
-                distortCoeff, movieFrame, dstFrame);
 
-                drawVirtualObjectOnChessboard(srcFrame, rotVec, transVec,
-                                              calibMatrix, distortCoeff,
-                                              vertices, faces, dstFrame);
+                if (mesh) {
+                    drawVirtualObjectOnChessboard(srcFrame, rotVec, transVec,
+                                                  calibMatrix, distortCoeff,
+                                                  *mesh, dstFrame, filledMesh);
+                }
 
                 // srcFrame.copyTo(dstFrame);
             } else {
@@ -344,6 +547,12 @@ int videoMode() {
             srcFrame.copyTo(dstFrame);
         }
 
+        publishFrame(frameRing, FRAME_RING_NAME, dstFrame, outputSlotBytes,
+                     frameId, captureNs, droppedOutput);
+        if (publishSource) {
+            publishFrame(sourceRing, SOURCE_RING_NAME, srcFrame,
+                         sourceSlotBytes, frameId, captureNs, droppedSource);
+        }
         cv::imshow("Video", dstFrame);
 
         // 9. If key strokes are pressed, set flags
@@ -365,6 +574,10 @@ int videoMode() {
             cout << "\n>>>>>>>>> calibrating" << endl;
             op = opCalibrate;
 
+        } else if (key == 'C') {
+            cout << "\n>>>>>>>>> full re-calibration" << endl;
+            op = opFullCalibrate;
+
         } else if (key == 'r') {
             cout << "\n>>>>>>>>> recording starts.. " << endl;
             record = true;
@@ -372,6 +585,22 @@ int videoMode() {
         } else if (key == 'i') {
             saveImage(dstFrame, "realtime_");
 
+        } else if (key == 'u') {
+            undistortMovie = !undistortMovie;
+            cout << "\n>>>>>>>>> movie distortion correction "
+                 << (undistortMovie ? "on" : "off") << endl;
+
+        } else if (key == 'w') {
+            filledMesh = !filledMesh;
+            cout << "\n>>>>>>>>> objects drawn "
+                 << (filledMesh ? "filled" : "as wireframe") << endl;
+
+        } else if (key == 'o') {
+            publishSource = !publishSource;
+            cout << "\n>>>>>>>>> camera frames "
+                 << (publishSource ? "published in " : "not published in ")
+                 << SOURCE_RING_NAME << endl;
+
         } else if (key == 't') {
             cout << "\n>>>>>>>>> calculate camera position..." << endl;
             op = opCameraPosition;
@@ -388,44 +617,25 @@ int videoMode() {
         } else if (key == 'a') {
             cout << "\n>>>>>>>>> aruco.." << endl;
             op = opDetectAruco;
+            movFile = movFiles.at(3);
+            movie = assets.movie(movFile);
 
         } else if (key == 'f') {
             cout << "fast corner detection.." << endl;
             op = opFast;
 
-        } else if (key == '1') {
-            cout << "\n>>>>>>>>> draw shuttle from obj file..." << endl;
-            op = opVirtualObj;
-   
-            vertices.clear();
-            faces.clear();
-            readObjFile("res/shuttle.obj", vertices, faces);
-            if (movieFrame.empty() || movFile != "res/space.mp4") {
-                movFile = "res/space.mp4";
-                capMovie = new cv::VideoCapture(movFile);
-            }
-        } else if (key == '2') {
-            cout << "\n>>>>>>>>> draw cow from obj file..." << endl;
-            op = opVirtualObj;
-
-            vertices.clear();
-            faces.clear();
-            readObjFile("res/cow.obj", vertices, faces);
-            if (movieFrame.empty() || movFile != "res/grass.mp4") {
-                movFile = "res/grass.mp4";
-                capMovie = new cv::VideoCapture(movFile);
-            }
-
-        } else if (key == '3') {
-            cout << "\n>>>>>>>>> draw plane from obj file..." << endl;
+        } else if (key >= '1' && key <= '3') {
+            const char *objNames[] = {"shuttle", "cow", "plane"};
+            int obj = key - '1';
+            cout << "\n>>>>>>>>> draw " << objNames[obj]
+                 << " from obj file..." << endl;
             op = opVirtualObj;
 
-            vertices.clear();
-            faces.clear();
-            readObjFile("res/plane.obj", vertices, faces);
-            if (movieFrame.empty() || movFile != "res/sky.mp4") {
-                movFile = "res/sky.mp4";
-                capMovie = new cv::VideoCapture(movFile);
+            // - swap in the preloaded assets
+            mesh = assets.mesh(objFiles.at(obj));
+            if (movFile != movFiles.at(obj)) {
+                movFile = movFiles.at(obj);
+                movie = assets.movie(movFile);
             }
         } else if (key == 32) {
             cout << ">>>>>>>>> reset..." << endl;
@@ -514,7 +724,268 @@ void imageMode() {
     }
 }
 
+/**
+ * @brief Name of a calibration engine on the command line: opencv or bundle
+ *
+ * @return false, with a message, for any other name
+ */
+bool parseEngine(string name, CalibEngine &engine) {
+    if (name == "opencv") {
+        engine = engineOpenCV;
+    } else if (name == "bundle") {
+        engine = engineBundle;
+    } else {
+        cout << "unknown engine " << name << ", use opencv or bundle" << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Pick the most informative views of a chessboard video and calibrate
+ * with them.
+ * usage: calib select --video <file> [--max <views>] [--engine opencv|bundle]
+ *                     [--reject <pixels>]
+ */
+int selectMode(int argc, char *argv[]) {
+    string videoPath;
+    int maxViews = 40;
+    CalibrationState state;
+    bool validEngine = true;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--video") {
+            videoPath = argv[i + 1];
+        } else if (arg == "--max") {
+            maxViews = atoi(argv[i + 1]);
+        } else if (arg == "--engine") {
+            validEngine = parseEngine(argv[i + 1], state.engine) && validEngine;
+        } else if (arg == "--reject") {
+            state.rejectThreshold = atof(argv[i + 1]);
+        }
+    }
+    if (videoPath.empty() || maxViews < 5 || !validEngine) {
+        cout << "usage: calib select --video <file> [--max <views>=5..]"
+             << " [--engine opencv|bundle] [--reject <pixels>]" << endl;
+        return (-1);
+    }
+
+    cv::Size chessboardSize(9, 6);
+    vector<vector<cv::Point2f>> listImagePoints;
+    vector<vector<cv::Point3f>> listWorldPoints;
+    vector<char *> imageNames;
+    cv::Size imageSize;
+    int numViews = selectViewsFromVideo(videoPath, chessboardSize, maxViews,
+                                        listImagePoints, listWorldPoints,
+                                        imageNames, imageSize);
+    if (numViews < 0) {
+        return (-1);  // the video could not be opened, already reported
+    }
+    if (numViews < 5) {
+        cout << "only " << numViews
+             << " usable views found, need at least 5 to calibrate" << endl;
+        return (-1);
+    }
+
+    cout << "calibrating with " << numViews << " selected views" << endl;
+    cv::Mat frame(imageSize, CV_8UC3);
+    calibrating(frame, listWorldPoints, listImagePoints, imageNames, state,
+                true);
+    return (0);
+}
+
+/**
+ * @brief Calibrate from a directory of chessboard images.
+ * usage: calib calibrate --images <dir> [--engine opencv|bundle]
+ *                        [--reject <pixels>]
+ */
+int calibrateMode(int argc, char *argv[]) {
+    string dirPath;
+    CalibrationState state;
+    bool validEngine = true;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--images") {
+            dirPath = argv[i + 1];
+        } else if (arg == "--engine") {
+            validEngine = parseEngine(argv[i + 1], state.engine) && validEngine;
+        } else if (arg == "--reject") {
+            state.rejectThreshold = atof(argv[i + 1]);
+        }
+    }
+    if (dirPath.empty() || !validEngine) {
+        cout << "usage: calib calibrate --images <dir> [--engine opencv|bundle]"
+             << " [--reject <pixels>]" << endl;
+        return (-1);
+    }
+
+    cv::Size chessboardSize(9, 6);
+    vector<vector<cv::Point2f>> listImagePoints;
+    vector<vector<cv::Point3f>> listWorldPoints;
+    vector<char *> imageNames;
+    cv::Size imageSize;
+    int numViews = detectChessboardsInDirectory(
+        dirPath, chessboardSize, listImagePoints, listWorldPoints, imageNames,
+        imageSize);
+    if (numViews < 5) {
+        cout << "you only have " << max(numViews, 0)
+             << " calibration images. Please add more" << endl;
+        return (-1);
+    }
+
+    cv::Mat frame(imageSize, CV_8UC3);
+    calibrating(frame, listWorldPoints, listImagePoints, imageNames, state,
+                true);
+    return (0);
+}
+
+/**
+ * @brief Confidence intervals of the calibration of the saved views.
+ * usage: calib bootstrap [--resamples <n>] [--engine opencv|bundle]
+ *                        [--size <width>x<height>]
+ * The image size is read from the first saved image unless --size is given.
+ */
+int bootstrapMode(int argc, char *argv[]) {
+    int numResamples = 100;
+    CalibEngine engine = engineOpenCV;
+    bool validEngine = true;
+    cv::Size imageSize;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--resamples") {
+            numResamples = atoi(argv[i + 1]);
+        } else if (arg == "--engine") {
+            validEngine = parseEngine(argv[i + 1], engine) && validEngine;
+        } else if (arg == "--size") {
+            sscanf(argv[i + 1], "%dx%d", &imageSize.width, &imageSize.height);
+        }
+    }
+    if (!validEngine) {
+        cout << "usage: calib bootstrap [--resamples <n>]"
+             << " [--engine opencv|bundle] [--size <width>x<height>]" << endl;
+        return (-1);
+    }
+
+    cv::Size chessboardSize(9, 6);
+    vector<vector<cv::Point2f>> listImagePoints;
+    vector<vector<cv::Point3f>> listWorldPoints;
+    vector<char *> imageNames;
+    char src_csv[] = "res/imageWorldPoints.csv";
+    loadCalibrationViews(src_csv, chessboardSize, listImagePoints,
+                         listWorldPoints, imageNames);
+    if (listImagePoints.size() < 5 || numResamples < 2) {
+        cout << "you only have " << listImagePoints.size()
+             << " calibration images. Please add more" << endl;
+        return (-1);
+    }
+
+    if (imageSize.area() == 0) {
+        cv::Mat first = cv::imread(string("res/") + imageNames.at(0));
+        if (first.empty()) {
+            cout << "cannot read res/" << imageNames.at(0)
+                 << ", give the image size with --size" << endl;
+            return (-1);
+        }
+        imageSize = first.size();
+    }
+
+    cout << "bootstrapping " << listImagePoints.size() << " views on "
+         << cv::getNumThreads() << " threads" << endl;
+    int64 start = cv::getTickCount();
+    BootstrapResult result = bootstrapCalibration(
+        listWorldPoints, listImagePoints, imageSize, numResamples, engine);
+    double seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+    printBootstrapReport(result, imageNames);
+    cout << "took " << seconds << "s" << endl;
+    return (0);
+}
+
+/**
+ * @brief Convert a csv calibration dataset to the binary dataset format.
+ * usage: calib convert --csv <file> --out <file>
+ */
+int convertMode(int argc, char *argv[]) {
+    string csvPath;
+    string outPath;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--csv") {
+            csvPath = argv[i + 1];
+        } else if (arg == "--out") {
+            outPath = argv[i + 1];
+        }
+    }
+    if (csvPath.empty() || outPath.empty()) {
+        cout << "usage: calib convert --csv <file> --out <file>" << endl;
+        return (-1);
+    }
+
+    cv::Size chessboardSize(9, 6);
+    vector<vector<cv::Point2f>> listImagePoints;
+    vector<vector<cv::Point3f>> listWorldPoints;
+    vector<char *> imageNames;
+    if (read2d3DVectorsFromCSV(&csvPath[0], chessboardSize, listImagePoints,
+                               listWorldPoints, imageNames, 0) != 0) {
+        return (-1);
+    }
+    if (writeCalibDataset(outPath, chessboardSize, listImagePoints,
+                          listWorldPoints, imageNames) != 0) {
+        return (-1);
+    }
+    cout << "wrote " << listImagePoints.size() << " views to " << outPath
+         << endl;
+    return (0);
+}
+
+/**
+ * @brief Run a benchmark.
+ * usage: calib bench calib|csv [--views <n>] [--opencv-max <n>]
+ */
+int benchMode(int argc, char *argv[]) {
+    string what = argc > 2 ? argv[2] : "";
+    int numViews = 5000;
+    int maxOpenCVViews = 1000;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--views") {
+            numViews = atoi(argv[i + 1]);
+        } else if (arg == "--opencv-max") {
+            maxOpenCVViews = atoi(argv[i + 1]);
+        }
+    }
+
+    if (what == "calib") {
+        benchCalibration(numViews, maxOpenCVViews);
+    } else if (what == "csv") {
+        benchCsv(numViews);
+    } else {
+        cout << "usage: calib bench calib|csv [--views <n>] [--opencv-max <n>]"
+             << endl;
+        return (-1);
+    }
+    return (0);
+}
+
 int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        string command = argv[1];
+        if (command == "select") {
+            return selectMode(argc, argv);
+        } else if (command == "calibrate") {
+            return calibrateMode(argc, argv);
+        } else if (command == "bootstrap") {
+            return bootstrapMode(argc, argv);
+        } else if (command == "convert") {
+            return convertMode(argc, argv);
+        } else if (command == "bench") {
+            return benchMode(argc, argv);
+        } else if (command == "video") {
+            return videoMode(argc, argv);
+        }
+        cout << "unknown command " << command << endl;
+        return (-1);
+    }
+
     char mode;
     cout << "enter mode: v video, i image" << endl;
 
@@ -522,7 +993,7 @@ int main(int argc, char *argv[]) {
 
     while (mode != 'q') {
         if (mode == 'v') {
-            videoMode();
+            videoMode(0, NULL);
         } else if (mode == 'i') {
             imageMode();
         }
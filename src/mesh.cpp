@@ -0,0 +1,356 @@
+//**********************************************************************************************************************
+// FILE: mesh.cpp
+//
+// DESCRIPTION
+// Contains implementation for the obj loader and its binary cache
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "mesh.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include "simplify.hpp"
+
+// longest number we parse
+static const size_t MAX_NUMBER_LENGTH = 64;
+
+/**
+ * @brief A read only file mapping
+ */
+class MappedFile {
+   public:
+    MappedFile() : data(NULL), size(0) {}
+    ~MappedFile() {
+        if (data) {
+            munmap((void *)data, size);
+        }
+    }
+
+    bool open(const string &path, struct stat &info) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = info.st_size;
+        if (size > 0) {
+            void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            data = p == MAP_FAILED ? NULL : (const char *)p;
+        }
+        ::close(fd);
+        return size == 0 || data != NULL;
+    }
+
+    const char *data;
+    size_t size;
+};
+
+static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+/**
+ * @brief Parse a float at p, p is moved past it
+ */
+static bool parseFloat(const char *&p, const char *end, float &v) {
+    while (p < end && isBlank(*p)) {
+        p++;
+    }
+    if (p < end && *p == '+') {
+        p++;
+    }
+#if defined(__cpp_lib_to_chars)
+    std::from_chars_result res = std::from_chars(p, end, v);
+    if (res.ec != std::errc()) {
+        return false;
+    }
+    p = res.ptr;
+#else
+    // standard libraries without floating point from_chars: strtof on a
+    // bounded copy of the number
+    char s[MAX_NUMBER_LENGTH];
+    size_t n = 0;
+    while (p + n < end && n < MAX_NUMBER_LENGTH - 1 && !isBlank(p[n]) &&
+           p[n] != '\n') {
+        s[n] = p[n];
+        n++;
+    }
+    s[n] = '\0';
+    char *stop;
+    v = strtof(s, &stop);
+    if (stop == s) {
+        return false;
+    }
+    p += stop - s;
+#endif
+    return true;
+}
+
+/**
+ * @brief Parse the vertex index of a face corner ("v", "v/vt", "v//vn" or
+ * "v/vt/vn") at p and move p past the whole corner
+ */
+static bool parseCorner(const char *&p, const char *end, int numVertices,
+                        int &index) {
+    int v = 0;
+    std::from_chars_result res = std::from_chars(p, end, v);
+    if (res.ec != std::errc() || v == 0) {
+        return false;
+    }
+    p = res.ptr;
+    while (p < end && !isBlank(*p) && *p != '\n') {
+        p++;  // skip texture and normal indices
+    }
+
+    // 1-based, or relative to the last vertex if negative
+    index = v > 0 ? v - 1 : numVertices + v;
+    return true;
+}
+
+bool parseObjFile(const string &path, Mesh &mesh) {
+    mesh.vertices.clear();
+    mesh.triangles.clear();
+
+    struct stat info;
+    MappedFile file;
+    if (!file.open(path, info)) {
+        printf("Unable to open %s\n", path.c_str());
+        return false;
+    }
+
+    const char *p = file.data;
+    const char *end = file.data + file.size;
+    vector<int> corners;
+    int badFaces = 0;
+    while (p < end) {
+        // 1. keyword of the line
+        while (p < end && isBlank(*p)) {
+            p++;
+        }
+        const char *key = p;
+        while (p < end && !isBlank(*p) && *p != '\n') {
+            p++;
+        }
+        size_t keyLength = p - key;
+
+        if (keyLength == 1 && *key == 'v') {
+            // 2. vertex, a 4th (w) coordinate is ignored
+            cv::Point3f v;
+            if (parseFloat(p, end, v.x) && parseFloat(p, end, v.y) &&
+                parseFloat(p, end, v.z)) {
+                mesh.vertices.push_back(v);
+            }
+
+        } else if (keyLength == 1 && *key == 'f') {
+            // 3. face, split in a fan of triangles
+            corners.clear();
+            int numVertices = mesh.vertices.size();
+            for (;;) {
+                while (p < end && isBlank(*p)) {
+                    p++;
+                }
+                int index;
+                if (p >= end || *p == '\n' ||
+                    !parseCorner(p, end, numVertices, index)) {
+                    break;
+                }
+                corners.push_back(index);
+            }
+            bool valid = corners.size() >= 3;
+            for (int i = 0; i < (int)corners.size(); i++) {
+                valid = valid && corners.at(i) >= 0 &&
+                        corners.at(i) < numVertices;
+            }
+            if (!valid) {
+                badFaces++;
+            } else {
+                for (int i = 1; i + 1 < (int)corners.size(); i++) {
+                    mesh.triangles.push_back(cv::Vec3i(
+                        corners.at(0), corners.at(i), corners.at(i + 1)));
+                }
+            }
+        }
+
+        // 4. rest of the line (comments, groups, materials...)
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        p = eol ? eol + 1 : end;
+    }
+
+    if (badFaces > 0) {
+        printf("%s: skipped %d faces with invalid indices\n", path.c_str(),
+               badFaces);
+    }
+    return true;
+}
+
+void buildEdges(Mesh &mesh) {
+    // 1. every side of every triangle, keyed by its two vertices
+    struct Side {
+        uint64_t key;  // smaller vertex in the high half
+        int face;
+    };
+    int numVertices = mesh.vertices.size();
+    vector<Side> sides;
+    sides.reserve(mesh.triangles.size() * 3);
+    for (int f = 0; f < (int)mesh.triangles.size(); f++) {
+        const cv::Vec3i &t = mesh.triangles.at(f);
+        for (int k = 0; k < 3; k++) {
+            int a = t[k], b = t[(k + 1) % 3];
+            if (a < 0 || b < 0 || a >= numVertices || b >= numVertices ||
+                a == b) {
+                continue;
+            }
+            if (a > b) {
+                std::swap(a, b);
+            }
+            sides.push_back({((uint64_t)a << 32) | (uint32_t)b, f});
+        }
+    }
+
+    // 2. the sides of one edge end up next to each other
+    std::sort(sides.begin(), sides.end(), [](const Side &l, const Side &r) {
+        return l.key < r.key || (l.key == r.key && l.face < r.face);
+    });
+
+    mesh.edges.clear();
+    mesh.closed = !sides.empty();
+    for (size_t i = 0; i < sides.size();) {
+        size_t j = i + 1;
+        while (j < sides.size() && sides.at(j).key == sides.at(i).key) {
+            j++;
+        }
+        MeshEdge edge;
+        edge.v[0] = sides.at(i).key >> 32;
+        edge.v[1] = (uint32_t)sides.at(i).key;
+        edge.faces[0] = sides.at(i).face;
+        edge.faces[1] = j - i == 2 ? sides.at(i + 1).face : -1;
+        mesh.closed = mesh.closed && j - i == 2;
+        mesh.edges.push_back(edge);
+        i = j;
+    }
+}
+
+string meshCachePath(const string &path) {
+    string cachePath = path;
+    size_t dot = cachePath.find_last_of('.');
+    if (dot != string::npos && cachePath.find('/', dot) == string::npos) {
+        cachePath = cachePath.substr(0, dot);
+    }
+    return cachePath.append(".mesh");
+}
+
+/**
+ * @brief Read the cache of an obj file, if it is up to date
+ */
+static bool readMeshCache(const string &cachePath, const struct stat &objInfo,
+                          Mesh &mesh) {
+    struct stat info;
+    MappedFile file;
+    if (!file.open(cachePath, info) || file.size < sizeof(MeshHeader)) {
+        return false;
+    }
+
+    MeshHeader header;
+    memcpy(&header, file.data, sizeof(header));
+    uint64_t expected = sizeof(MeshHeader) +
+                        (uint64_t)header.numVertices * sizeof(cv::Point3f) +
+                        (uint64_t)header.numTriangles * sizeof(cv::Vec3i);
+    if (memcmp(header.magic, MESH_MAGIC, 4) != 0 ||
+        header.version != MESH_VERSION ||
+        header.objSize != (uint64_t)objInfo.st_size ||
+        header.objMtime != (int64_t)objInfo.st_mtime ||
+        expected != file.size) {
+        return false;
+    }
+
+    const char *p = file.data + sizeof(MeshHeader);
+    mesh.vertices.resize(header.numVertices);
+    memcpy(mesh.vertices.data(), p, header.numVertices * sizeof(cv::Point3f));
+    p += header.numVertices * sizeof(cv::Point3f);
+    mesh.triangles.resize(header.numTriangles);
+    memcpy(mesh.triangles.data(), p, header.numTriangles * sizeof(cv::Vec3i));
+
+    // the cache was written by this loader, still check the indices
+    for (const cv::Vec3i &t : mesh.triangles) {
+        for (int k = 0; k < 3; k++) {
+            if (t[k] < 0 || t[k] >= (int)header.numVertices) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Write the cache of an obj file, through a temporary file so a
+ * reader never sees a half written cache
+ */
+static bool writeMeshCache(const string &cachePath, const struct stat &objInfo,
+                           const Mesh &mesh) {
+    MeshHeader header;
+    memcpy(header.magic, MESH_MAGIC, 4);
+    header.version = MESH_VERSION;
+    header.numVertices = mesh.vertices.size();
+    header.numTriangles = mesh.triangles.size();
+    header.objSize = objInfo.st_size;
+    header.objMtime = objInfo.st_mtime;
+
+    string tmpPath = cachePath + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(mesh.vertices.data(), sizeof(cv::Point3f), mesh.vertices.size(),
+           fp);
+    fwrite(mesh.triangles.data(), sizeof(cv::Vec3i), mesh.triangles.size(),
+           fp);
+    bool failed = ferror(fp);
+    fclose(fp);
+    if (failed || rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadMesh(const string &path, Mesh &mesh, cv::Point3f offset) {
+    struct stat objInfo;
+    if (stat(path.c_str(), &objInfo) != 0) {
+        printf("file %s does not exist\n", path.c_str());
+        return false;
+    }
+
+    // 1. cache, 2. or parse the obj file and cache it for next time
+    string cachePath = meshCachePath(path);
+    if (!readMeshCache(cachePath, objInfo, mesh)) {
+        if (!parseObjFile(path, mesh)) {
+            return false;
+        }
+        if (!writeMeshCache(cachePath, objInfo, mesh)) {
+            printf("Unable to write %s\n", cachePath.c_str());
+        }
+    }
+
+    // 3. place it
+    for (cv::Point3f &v : mesh.vertices) {
+        v += offset;
+    }
+
+    // 4. edges for the wireframe, 5. levels of detail
+    buildEdges(mesh);
+    buildLods(mesh);
+    return true;
+}
@@ -0,0 +1,95 @@
+//**********************************************************************************************************************
+// FILE: mesh.hpp
+//
+// DESCRIPTION
+// Triangle meshes loaded from obj files. The obj file is memory mapped and
+// parsed in place, the result is cached in a binary file next to it
+// (res/cow.obj -> res/cow.mesh) that later runs load without parsing.
+//
+// The cache file is laid out as
+//   MeshHeader
+//   vertices    numVertices X 3 floats
+//   triangles   numTriangles X 3 int32, 0-based vertex indices
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef MESH_H
+#define MESH_H
+
+#include <stdint.h>
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+using namespace std;
+
+static const char MESH_MAGIC[4] = {'M', 'E', 'S', 'H'};
+static const uint32_t MESH_VERSION = 1;
+
+struct MeshHeader {
+    char magic[4];  // MESH_MAGIC
+    uint32_t version;
+    uint32_t numVertices;
+    uint32_t numTriangles;
+    uint64_t objSize;   // size of the obj file the cache was made from
+    int64_t objMtime;   // and its modification time
+};
+
+struct MeshEdge {
+    int v[2];      // vertices, v[0] < v[1]
+    int faces[2];  // triangles on each side, faces[1] is -1 on a border
+};
+
+struct Mesh {
+    vector<cv::Point3f> vertices;
+    vector<cv::Vec3i> triangles;  // 0-based indices into vertices
+    vector<MeshEdge> edges;       // each edge once, made by buildEdges
+    bool closed = false;  // every edge is between exactly two triangles
+
+    // made by buildLods
+    vector<Mesh> lods;    // less and less detailed versions of the mesh
+    cv::Point3f center;   // bounding sphere
+    float radius = 0;
+};
+
+/**
+ * @brief Parse an obj file. Faces with more than 3 vertices are split in a
+ * fan of triangles, "v/vt/vn" and negative (relative) indices are supported,
+ * everything except vertices and faces is ignored.
+ *
+ * @param path the obj file
+ * @param mesh the output mesh
+ * @return true if the file could be read
+ */
+bool parseObjFile(const string &path, Mesh &mesh);
+
+/**
+ * @brief List the edges of the triangles once each, with the triangles on
+ * both sides. An edge shared by more than two triangles is kept as a border
+ * so it is always drawn.
+ *
+ * @param mesh the mesh, its edges and closed flag are set
+ */
+void buildEdges(Mesh &mesh);
+
+/**
+ * @brief Load an obj file through its binary cache. The cache is used if it
+ * was made from an obj file of the same size and modification time,
+ * otherwise the obj file is parsed and the cache written again. The edge
+ * list and the levels of detail are built after loading.
+ *
+ * @param path the obj file
+ * @param mesh the output mesh
+ * @param offset added to every vertex, to place the mesh on the chessboard
+ * @return true if the mesh could be loaded
+ */
+bool loadMesh(const string &path, Mesh &mesh,
+              cv::Point3f offset = cv::Point3f(0, 0, 0));
+
+/**
+ * @brief Path of the cache file of an obj file
+ */
+string meshCachePath(const string &path);
+
+#endif
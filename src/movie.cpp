@@ -0,0 +1,212 @@
+//**********************************************************************************************************************
+// FILE: movie.cpp
+//
+// DESCRIPTION
+// Contains implementation for the background movie decoder
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "movie.hpp"
+
+#include <algorithm>
+
+// a gap between two camera frames longer than this pauses the movie
+static const uint64_t MAX_FRAME_GAP_NS = 250000000;
+
+// frame rate of movies that do not tell theirs
+static const double DEFAULT_FPS = 30;
+
+MovieSource::MovieSource()
+    : fps(DEFAULT_FPS), stopping(false), due(0), stride(1), clockStartNs(0),
+      clockStartIndex(0), lastCallNs(0), shownIndex(-1), queueSize(0) {}
+
+MovieSource::~MovieSource() { close(); }
+
+bool MovieSource::open(const string &moviePath,
+                       const MovieCacheSettings &cache, int size) {
+    close();
+    if (!capture.open(moviePath)) {
+        printf("Unable to open movie %s\n", moviePath.c_str());
+        return false;
+    }
+    path = moviePath;
+    queueSize = std::max(size, 1);
+    fps = capture.get(cv::CAP_PROP_FPS);
+    if (!(fps > 0 && fps < 1000)) {
+        fps = DEFAULT_FPS;
+    }
+
+    // 1. the clock starts with the first frame shown
+    due = 0;
+    stride = 1;
+    lastCallNs = 0;
+    shownIndex = -1;
+
+    // 2. short movie, keep it all in memory and no decoder is needed
+    if (cache.maxBytes > 0) {
+        if (decodeAll(cache)) {
+            capture.release();
+            return true;
+        }
+        if (!capture.open(path)) {  // back to the start for streaming
+            return false;
+        }
+    }
+
+    // 3. a buffer per queued frame, plus the one shown and the one decoding
+    pool.assign(queueSize + 2, cv::Mat());
+    stopping = false;
+    thread = std::thread(&MovieSource::run, this);
+    return true;
+}
+
+void MovieSource::close() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+    capture.release();
+    ready.clear();
+    pool.clear();
+    shown.release();
+    frames.clear();
+}
+
+bool MovieSource::decodeAll(const MovieCacheSettings &cache) {
+    size_t bytes = 0;
+    cv::Mat frame;
+    while (capture.read(frame)) {
+        // 1. scale down to the size it is shown at
+        double scale = 1;
+        if (cache.frameSize.area() > 0) {
+            scale = std::min({1.0, (double)cache.frameSize.width / frame.cols,
+                              (double)cache.frameSize.height / frame.rows});
+        }
+        cv::Mat stored;
+        if (scale < 1) {
+            cv::resize(frame, stored, cv::Size(), scale, scale,
+                       cv::INTER_AREA);
+        } else {
+            stored = frame.clone();
+        }
+
+        // 2. too long, stream it instead
+        bytes += stored.total() * stored.elemSize();
+        if (bytes > cache.maxBytes) {
+            printf("%s does not fit in %zu MiB, streaming it\n", path.c_str(),
+                   cache.maxBytes >> 20);
+            frames.clear();
+            return false;
+        }
+        frames.push_back(stored);
+    }
+    if (frames.empty()) {
+        return false;
+    }
+    printf("%s: %d frames cached, %zu MiB\n", path.c_str(),
+           (int)frames.size(), bytes >> 20);
+    return true;
+}
+
+cv::Mat MovieSource::latest(uint64_t timestampNs) {
+    // 1. movie clock, paused while the movie is not shown
+    int64_t gap = (int64_t)(timestampNs - lastCallNs);
+    if (lastCallNs == 0 || gap < 0 || gap > (int64_t)MAX_FRAME_GAP_NS) {
+        clockStartNs = timestampNs;
+        clockStartIndex = shownIndex + 1;
+    }
+    lastCallNs = timestampNs;
+    int64_t dueIndex =
+        clockStartIndex +
+        (int64_t)((timestampNs - clockStartNs) * 1e-9 * fps);
+    stride = std::max<int64_t>(dueIndex - due.load(), 1);
+    due = dueIndex;
+
+    // 2. cached, every frame is there
+    if (!frames.empty()) {
+        shownIndex = dueIndex;
+        return frames.at(dueIndex % frames.size());
+    }
+
+    // 3. newest decoded frame that is due, the later ones wait
+    std::lock_guard<std::mutex> guard(lock);
+    bool popped = false;
+    while (!ready.empty() && ready.front().index <= dueIndex) {
+        // the frame handed out by the previous call goes back to the pool,
+        // the caller is done with it
+        if (!shown.empty()) {
+            pool.push_back(shown);
+        }
+        shown = ready.front().image;
+        shownIndex = ready.front().index;
+        ready.pop_front();
+        popped = true;
+    }
+    if (popped) {
+        wake.notify_one();  // room in the queue
+    }
+    return shown;
+}
+
+bool MovieSource::grab() {
+    if (capture.grab()) {
+        return true;
+    }
+
+    // 1. end of the movie, seek back to the start
+    capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+    if (capture.grab()) {
+        return true;
+    }
+
+    // 2. the backend can not seek, open it again
+    return capture.open(path) && capture.grab();
+}
+
+void MovieSource::run() {
+    int64_t nextIndex = 0;  // index of the next frame grab() returns
+    int64_t wanted = 0;     // next frame worth decoding
+    while (!stopping) {
+        // 1. wait for room in the queue and take a buffer
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this]() {
+                return stopping || (int)ready.size() < queueSize;
+            });
+            if (stopping) {
+                break;
+            }
+            if (!pool.empty()) {
+                frame = pool.back();
+                pool.pop_back();
+            }
+        }
+
+        // 2. grab without decoding the frames that are late already or fall
+        // between two camera frames
+        wanted = std::max(wanted, due.load());
+        bool ok = true;
+        while (ok && nextIndex < wanted && !stopping) {
+            ok = grab();
+            nextIndex++;
+        }
+
+        // 3. decode the wanted one without holding the lock
+        if (!ok || !grab() || !capture.retrieve(frame)) {
+            printf("Unable to decode movie %s\n", path.c_str());
+            break;
+        }
+        int64_t index = nextIndex++;
+        wanted = index + stride.load();
+
+        std::lock_guard<std::mutex> guard(lock);
+        ready.push_back({index, frame});
+    }
+}
@@ -0,0 +1,133 @@
+//**********************************************************************************************************************
+// FILE: movie.hpp
+//
+// DESCRIPTION
+// A movie that is decoded on its own thread. Decoded frames wait in a small
+// queue of pooled buffers, the video loop takes the next one without ever
+// waiting for the decoder. The movie loops by seeking back to the start.
+//
+// Playback follows the clock of the camera frames: every camera frame asks
+// for the movie frame due at its timestamp. Frames that will not be shown
+// are only grabbed, not decoded into an image, and a frame is shown again
+// when the camera is faster than the movie.
+//
+// A short movie can instead be decoded once into memory, scaled down to the
+// size it is shown at, and played from there without any decoding.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief How a movie may be kept in memory
+ */
+struct MovieCacheSettings {
+    cv::Size frameSize;   // frames are scaled down to fit in it, empty: keep
+    size_t maxBytes = 0;  // the movie is streamed if it needs more, 0: always
+};
+
+class MovieSource {
+   public:
+    MovieSource();
+    ~MovieSource();
+
+    /**
+     * @brief Open a movie and start decoding it
+     *
+     * @param path the movie file
+     * @param cache decode it all into memory if it fits, otherwise stream it
+     * @param queueSize the number of frames decoded ahead when streaming
+     * @return true if the movie could be opened
+     */
+    bool open(const string &path,
+              const MovieCacheSettings &cache = MovieCacheSettings(),
+              int queueSize = 3);
+
+    /**
+     * @brief Stop decoding and close the movie
+     */
+    void close();
+
+    bool isOpened() const { return thread.joinable() || !frames.empty(); }
+
+    /**
+     * @brief The movie frame due at a camera timestamp, or the last one again
+     * if the decoder is behind. Never blocks. The movie clock starts with the
+     * first call and pauses while the movie is not shown.
+     *
+     * The frame is lent to the caller until the next call: then its buffer
+     * goes back to the pool and the decoder writes the next frames into it,
+     * whether or not the caller still holds a cv::Mat of it.
+     *
+     * @param timestampNs capture time of the camera frame (monotonicNs)
+     * @return the frame, empty until the first frame is decoded
+     */
+    cv::Mat latest(uint64_t timestampNs);
+
+    /**
+     * @brief index of the frame returned by the last latest(), it counts on
+     * over the loops of the movie
+     */
+    int64_t frameIndex() const { return shownIndex; }
+
+   private:
+    struct Frame {
+        int64_t index;  // counts on over the loops of the movie
+        cv::Mat image;
+    };
+
+    void run();
+
+    /**
+     * @brief Decode the whole movie into frames
+     *
+     * @return false if it does not fit in the cache
+     */
+    bool decodeAll(const MovieCacheSettings &cache);
+
+    /**
+     * @brief Grab the next frame, starting over at the end of the movie
+     */
+    bool grab();
+
+    string path;
+    cv::VideoCapture capture;  // only used by the decode thread
+    double fps;
+    std::thread thread;
+    std::atomic<bool> stopping;
+
+    // set by latest() for the decoder
+    std::atomic<int64_t> due;     // index of the frame due now
+    std::atomic<int64_t> stride;  // frames the clock moves per camera frame
+
+    // movie clock, only used by latest()
+    uint64_t clockStartNs;
+    int64_t clockStartIndex;
+    uint64_t lastCallNs;
+    int64_t shownIndex;
+
+    std::mutex lock;  // guards the queue and the pool
+    std::condition_variable wake;
+    std::deque<Frame> ready;  // decoded, oldest first
+    vector<cv::Mat> pool;     // buffers to decode into
+    cv::Mat shown;            // lent to the caller by the last latest()
+    int queueSize;
+
+    vector<cv::Mat> frames;  // the whole movie, if it is cached
+};
+
+#endif
@@ -0,0 +1,103 @@
+//**********************************************************************************************************************
+// FILE: offline.cpp
+//
+// DESCRIPTION
+// Contains implementation for calibrating from files
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "offline.hpp"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <iostream>
+using namespace std;
+
+/**
+ * @brief true if the file name ends with one of the image extensions imread
+ * can load
+ */
+static bool isImageFile(string name) {
+    size_t dot = name.find_last_of('.');
+    if (dot == string::npos) {
+        return false;
+    }
+    string ext = name.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "bmp";
+}
+
+int detectChessboardsInDirectory(const string &dirPath, cv::Size chessboardSize,
+                                 vector<vector<cv::Point2f>> &listImagePoints,
+                                 vector<vector<cv::Point3f>> &listWorldPoints,
+                                 vector<char *> &imageNames,
+                                 cv::Size &imageSize) {
+    // 1. list the images, sorted so the order does not depend on the file
+    // system
+    DIR *dir = opendir(dirPath.c_str());
+    if (!dir) {
+        cout << "Unable to open directory " << dirPath << endl;
+        return (-1);
+    }
+    vector<string> files;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (isImageFile(entry->d_name)) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+
+    string prefix = dirPath;
+    if (!prefix.empty() && prefix.back() != '/') {
+        prefix.append("/");
+    }
+
+    // 2. detect concurrently, every task only writes its own slot
+    vector<vector<cv::Point2f>> corners(files.size());
+    vector<char> found(files.size(), 0);
+    vector<cv::Size> sizes(files.size());
+    cv::parallel_for_(cv::Range(0, files.size()), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++) {
+            cv::Mat image = cv::imread(prefix + files.at(i), cv::IMREAD_COLOR);
+            if (image.empty()) {
+                continue;
+            }
+            sizes.at(i) = image.size();
+            found.at(i) =
+                findChessboard(image, corners.at(i), chessboardSize, false);
+        }
+    });
+
+    // 3. collect in file order
+    vector<cv::Point3f> worldPoints;
+    createWorldPoints(chessboardSize, worldPoints);
+    int numViews = 0;
+    for (int i = 0; i < files.size(); i++) {
+        if (!found.at(i)) {
+            cout << "no chessboard detected in " << files.at(i) << endl;
+            continue;
+        }
+        if (numViews == 0) {
+            imageSize = sizes.at(i);
+        } else if (sizes.at(i) != imageSize) {
+            cout << "skipping " << files.at(i) << ", size differs" << endl;
+            continue;
+        }
+
+        listImagePoints.push_back(corners.at(i));
+        listWorldPoints.push_back(worldPoints);
+        char *nameChar = new char[files.at(i).size() + 1];
+        strcpy(nameChar, files.at(i).c_str());
+        imageNames.push_back(nameChar);
+        numViews++;
+    }
+
+    cout << "chessboard found in " << numViews << " of " << files.size()
+         << " images" << endl;
+    return numViews;
+}
@@ -0,0 +1,39 @@
+//**********************************************************************************************************************
+// FILE: offline.hpp
+//
+// DESCRIPTION
+// Contains functions for calibrating from files instead of the live camera
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef OFFLINE_H
+#define OFFLINE_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "filter.hpp"
+
+/**
+ * @brief Detect the chessboard in every image of a directory. The images are
+ * processed concurrently on all cores, but the lists are filled in file name
+ * order so the result is the same on every run. Images without a chessboard
+ * are skipped.
+ *
+ * @param dirPath the directory with the images (png, jpg, jpeg, bmp)
+ * @param chessboardSize the width and height cell of the chessboard
+ * @param listImagePoints the list to push the 2D points to
+ * @param listWorldPoints the list to push the 3D points to
+ * @param imageNames the list to push the file names to
+ * @param imageSize the output size of the images
+ * @return int -1 if the directory could not be read, else the number of views
+ */
+int detectChessboardsInDirectory(const string &dirPath, cv::Size chessboardSize,
+                                 vector<vector<cv::Point2f>> &listImagePoints,
+                                 vector<vector<cv::Point3f>> &listWorldPoints,
+                                 vector<char *> &imageNames,
+                                 cv::Size &imageSize);
+
+#endif
@@ -0,0 +1,446 @@
+//**********************************************************************************************************************
+// FILE: overlay.cpp
+//
+// DESCRIPTION
+// Contains implementation for the movie overlay helpers
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "overlay.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+// no level is smaller than this in either direction
+static const int MIN_LEVEL_SIZE = 8;
+
+MipPyramid::MipPyramid() : key(-1) {}
+
+void MipPyramid::reset(const cv::Mat &frame, int64_t frameKey) {
+    if (!mips.empty() && key == frameKey && mips.at(0).data == frame.data &&
+        mips.at(0).size() == frame.size()) {
+        return;  // same frame, keep its levels
+    }
+    mips.assign(1, frame);
+    key = frameKey;
+}
+
+const cv::Mat &MipPyramid::level(int n) {
+    n = std::max(n, 0);
+    while ((int)mips.size() <= n) {
+        const cv::Mat &last = mips.back();
+        if (last.cols / 2 < MIN_LEVEL_SIZE || last.rows / 2 < MIN_LEVEL_SIZE) {
+            break;
+        }
+        cv::Mat next;
+        cv::pyrDown(last, next);
+        mips.push_back(next);
+    }
+    return mips.at(std::min(n, (int)mips.size() - 1));
+}
+
+int MipPyramid::chooseLevel(const cv::Matx33d &homography) const {
+    if (empty()) {
+        return 0;
+    }
+
+    // 1. the screen area of a texel at level 0 pixel m is |det H| / w(m)^3,
+    // evaluate it at the corners of the frame where it is smallest/largest
+    double det = std::fabs(cv::determinant(homography));
+    if (det <= 0) {
+        return 0;
+    }
+    cv::Size s = size();
+    double corners[4][2] = {
+        {0, 0}, {(double)s.width, 0}, {(double)s.width, (double)s.height},
+        {0, (double)s.height}};
+    double minTexels = HUGE_VAL;
+    for (int i = 0; i < 4; i++) {
+        double w = homography(2, 0) * corners[i][0] +
+                   homography(2, 1) * corners[i][1] + homography(2, 2);
+        // 2. texels per screen pixel, along one direction
+        double texels = std::sqrt(std::fabs(w * w * w) / det);
+        minTexels = std::min(minTexels, texels);
+    }
+
+    // 3. every halving of the frame keeps at least one texel per pixel
+    if (!(minTexels > 1)) {
+        return 0;
+    }
+    return (int)std::floor(std::log2(minTexels));
+}
+
+cv::Matx33d MipPyramid::levelHomography(const cv::Matx33d &homography,
+                                        int n) {
+    const cv::Mat &mip = level(n);
+    cv::Size s = size();
+    cv::Matx33d scale(s.width / (double)mip.cols, 0, 0, 0,
+                      s.height / (double)mip.rows, 0, 0, 0, 1);
+    return homography * scale;
+}
+
+/**
+ * @brief Everything the rows of the warp need, shared by the threads
+ */
+struct WarpBlendJob {
+    const cv::Mat *texture;  // mip level to sample
+    cv::Matx33d inverse;     // image pixel to texture pixel
+    double edgeA[4];         // edge i: a x + b y + c is the distance in
+    double edgeB[4];         // pixels to the edge, positive inside
+    double edgeC[4];
+    int xBegin, xEnd;  // columns of the bounding rectangle
+    cv::Mat *dstFrame;
+    const cv::Mat *undistortMap;  // null: the image has no distortion
+};
+
+/**
+ * @brief Texture coordinates and coverage of the part of row y inside the
+ * quad. The pixel is fully covered one pixel inside the edges and fades out
+ * towards them. Whole SIMD registers of pixels at a time, then one by one
+ * for the end of the row.
+ *
+ * @return false if the row does not cross the quad
+ */
+static bool straightRow(const WarpBlendJob &job, int y, int maxX, int maxY,
+                        int &x0, int &n, float *tx, float *ty, float *cover) {
+    const cv::Matx33d &m = job.inverse;
+
+    // 1. span of the row inside every edge
+    double lo = job.xBegin;
+    double hi = job.xEnd - 1;
+    double rowC[4];
+    for (int i = 0; i < 4; i++) {
+        rowC[i] = job.edgeB[i] * y + job.edgeC[i];
+        double a = job.edgeA[i];
+        if (std::fabs(a) < 1e-12) {
+            if (rowC[i] <= 0) {
+                return false;  // the whole row is outside
+            }
+        } else if (a > 0) {
+            lo = std::max(lo, std::ceil(-rowC[i] / a));
+        } else {
+            hi = std::min(hi, std::floor(-rowC[i] / a));
+        }
+    }
+    if (lo > hi) {
+        return false;
+    }
+    x0 = (int)lo;
+    n = (int)hi - x0 + 1;
+
+    // 2. everything is linear along the row
+    float u0 = m(0, 0) * x0 + m(0, 1) * y + m(0, 2);
+    float v0 = m(1, 0) * x0 + m(1, 1) * y + m(1, 2);
+    float w0 = m(2, 0) * x0 + m(2, 1) * y + m(2, 2);
+    float du = m(0, 0), dv = m(1, 0), dw = m(2, 0);
+    float ea[4], ec[4];
+    for (int i = 0; i < 4; i++) {
+        ea[i] = job.edgeA[i];
+        ec[i] = job.edgeA[i] * x0 + rowC[i];
+    }
+    int k = 0;
+#if CV_SIMD
+    // 3. lane j of the registers is pixel k + j
+    const int lanes = cv::v_float32::nlanes;
+    float offsets[cv::v_float32::nlanes];
+    for (int j = 0; j < lanes; j++) {
+        offsets[j] = (float)j;
+    }
+    cv::v_float32 vk = cv::vx_load(offsets);
+    const cv::v_float32 vStep = cv::vx_setall_f32((float)lanes);
+    const cv::v_float32 vZero = cv::vx_setall_f32(0.0f);
+    const cv::v_float32 vOne = cv::vx_setall_f32(1.0f);
+    const cv::v_float32 vMaxX = cv::vx_setall_f32((float)maxX);
+    const cv::v_float32 vMaxY = cv::vx_setall_f32((float)maxY);
+    const cv::v_float32 vu0 = cv::vx_setall_f32(u0), vdu = cv::vx_setall_f32(du);
+    const cv::v_float32 vv0 = cv::vx_setall_f32(v0), vdv = cv::vx_setall_f32(dv);
+    const cv::v_float32 vw0 = cv::vx_setall_f32(w0), vdw = cv::vx_setall_f32(dw);
+    cv::v_float32 vea[4], vec[4];
+    for (int i = 0; i < 4; i++) {
+        vea[i] = cv::vx_setall_f32(ea[i]);
+        vec[i] = cv::vx_setall_f32(ec[i]);
+    }
+    for (; k <= n - lanes; k += lanes, vk = vk + vStep) {
+        cv::v_float32 w = vOne / (vw0 + vdw * vk);
+        cv::v_store(tx + k,
+                    cv::v_min(cv::v_max((vu0 + vdu * vk) * w, vZero), vMaxX));
+        cv::v_store(ty + k,
+                    cv::v_min(cv::v_max((vv0 + vdv * vk) * w, vZero), vMaxY));
+        cv::v_float32 d =
+            cv::v_min(cv::v_min(vec[0] + vea[0] * vk, vec[1] + vea[1] * vk),
+                      cv::v_min(vec[2] + vea[2] * vk, vec[3] + vea[3] * vk));
+        cv::v_store(cover + k, cv::v_min(cv::v_max(d, vZero), vOne));
+    }
+#endif
+    for (; k < n; k++) {
+        float w = 1.0f / (w0 + dw * k);
+        tx[k] = std::min(std::max((u0 + du * k) * w, 0.0f), (float)maxX);
+        ty[k] = std::min(std::max((v0 + dv * k) * w, 0.0f), (float)maxY);
+        float d = std::min(std::min(ec[0] + ea[0] * k, ec[1] + ea[1] * k),
+                           std::min(ec[2] + ea[2] * k, ec[3] + ea[3] * k));
+        cover[k] = std::min(std::max(d, 0.0f), 1.0f);
+    }
+    return true;
+}
+
+/**
+ * @brief Like straightRow for an image with lens distortion, where the quad
+ * is curved: the whole row of the bounds, every pixel is first moved to its
+ * undistorted position
+ */
+static void distortedRow(const WarpBlendJob &job, int y, int maxX, int maxY,
+                         float *tx, float *ty, float *cover) {
+    const cv::Matx33d &m = job.inverse;
+    const float *ideal = job.undistortMap->ptr<float>(y) + 2 * job.xBegin;
+    float ea[4], eb[4], ec[4];
+    for (int i = 0; i < 4; i++) {
+        ea[i] = job.edgeA[i];
+        eb[i] = job.edgeB[i];
+        ec[i] = job.edgeC[i];
+    }
+    int n = job.xEnd - job.xBegin;
+    int k = 0;
+#if CV_SIMD
+    const int lanes = cv::v_float32::nlanes;
+    const cv::v_float32 vZero = cv::vx_setall_f32(0.0f);
+    const cv::v_float32 vOne = cv::vx_setall_f32(1.0f);
+    const cv::v_float32 vMaxX = cv::vx_setall_f32((float)maxX);
+    const cv::v_float32 vMaxY = cv::vx_setall_f32((float)maxY);
+    cv::v_float32 vm[3][3];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            vm[r][c] = cv::vx_setall_f32((float)m(r, c));
+        }
+    }
+    cv::v_float32 vea[4], veb[4], vec[4];
+    for (int i = 0; i < 4; i++) {
+        vea[i] = cv::vx_setall_f32(ea[i]);
+        veb[i] = cv::vx_setall_f32(eb[i]);
+        vec[i] = cv::vx_setall_f32(ec[i]);
+    }
+    for (; k <= n - lanes; k += lanes) {
+        cv::v_float32 px, py;
+        cv::v_load_deinterleave(ideal + 2 * k, px, py);
+        cv::v_float32 w = vOne / (vm[2][0] * px + vm[2][1] * py + vm[2][2]);
+        cv::v_float32 u = (vm[0][0] * px + vm[0][1] * py + vm[0][2]) * w;
+        cv::v_float32 v = (vm[1][0] * px + vm[1][1] * py + vm[1][2]) * w;
+        cv::v_store(tx + k, cv::v_min(cv::v_max(u, vZero), vMaxX));
+        cv::v_store(ty + k, cv::v_min(cv::v_max(v, vZero), vMaxY));
+        cv::v_float32 d[4];
+        for (int i = 0; i < 4; i++) {
+            d[i] = vea[i] * px + veb[i] * py + vec[i];
+        }
+        cv::v_float32 inside =
+            cv::v_min(cv::v_min(d[0], d[1]), cv::v_min(d[2], d[3]));
+        cv::v_store(cover + k, cv::v_min(cv::v_max(inside, vZero), vOne));
+    }
+#endif
+    for (; k < n; k++) {
+        float px = ideal[2 * k];
+        float py = ideal[2 * k + 1];
+        float w = 1.0f / (m(2, 0) * px + m(2, 1) * py + m(2, 2));
+        float u = (m(0, 0) * px + m(0, 1) * py + m(0, 2)) * w;
+        float v = (m(1, 0) * px + m(1, 1) * py + m(1, 2)) * w;
+        tx[k] = std::min(std::max(u, 0.0f), (float)maxX);
+        ty[k] = std::min(std::max(v, 0.0f), (float)maxY);
+        float d = std::min(std::min(ea[0] * px + eb[0] * py + ec[0],
+                                    ea[1] * px + eb[1] * py + ec[1]),
+                           std::min(ea[2] * px + eb[2] * py + ec[2],
+                                    ea[3] * px + eb[3] * py + ec[3]));
+        cover[k] = std::min(std::max(d, 0.0f), 1.0f);
+    }
+}
+
+/**
+ * @brief Warp, sample and blend the rows [yBegin, yEnd) of the quad. Each row
+ * is done in two passes: the texture coordinates and the edge coverage of
+ * the whole span, then the bilinear fetches and the blend.
+ */
+static void warpBlendRows(const WarpBlendJob &job, int yBegin, int yEnd) {
+    const cv::Mat &texture = *job.texture;
+    cv::Mat &dstFrame = *job.dstFrame;
+    const int cn = texture.channels();
+    const int maxX = texture.cols - 1;
+    const int maxY = texture.rows - 1;
+
+    int width = job.xEnd - job.xBegin;
+    vector<float> texX(width), texY(width), coverage(width);
+    float *tx = texX.data();
+    float *ty = texY.data();
+    float *cover = coverage.data();
+    for (int y = yBegin; y < yEnd; y++) {
+        // 1. texture coordinates and coverage
+        int x0 = job.xBegin;
+        int n = width;
+        if (job.undistortMap) {
+            distortedRow(job, y, maxX, maxY, tx, ty, cover);
+        } else if (!straightRow(job, y, maxX, maxY, x0, n, tx, ty, cover)) {
+            continue;
+        }
+
+        // 2. bilinear sample and blend into the image
+        uchar *out = dstFrame.ptr<uchar>(y) + x0 * cn;
+        for (int k = 0; k < n; k++, out += cn) {
+            float c = cover[k];
+            if (c <= 0) {
+                continue;
+            }
+            int ix = std::min((int)tx[k], std::max(maxX - 1, 0));
+            int iy = std::min((int)ty[k], std::max(maxY - 1, 0));
+            float ax = tx[k] - ix;
+            float ay = ty[k] - iy;
+            const uchar *p00 = texture.ptr<uchar>(iy) + ix * cn;
+            const uchar *p01 = maxX > 0 ? p00 + cn : p00;
+            const uchar *p10 = maxY > 0 ? p00 + texture.step[0] : p00;
+            const uchar *p11 = maxX > 0 ? p10 + cn : p10;
+            for (int ch = 0; ch < cn; ch++) {
+                float top = p00[ch] + ax * (p01[ch] - p00[ch]);
+                float bottom = p10[ch] + ax * (p11[ch] - p10[ch]);
+                float value = top + ay * (bottom - top);
+                out[ch] = cv::saturate_cast<uchar>(out[ch] +
+                                                   c * (value - out[ch]));
+            }
+        }
+    }
+}
+
+void compositeQuad(MipPyramid &movie, const cv::Matx33d &homography,
+                   cv::Mat &dstFrame, const cv::Mat &undistortMap,
+                   cv::Rect bounds) {
+    bool distorted = !undistortMap.empty();
+    if (distorted && (undistortMap.type() != CV_32FC2 ||
+                      undistortMap.size() != dstFrame.size())) {
+        return;
+    }
+    if (movie.empty() || dstFrame.empty() ||
+        movie.level(0).type() != dstFrame.type() ||
+        dstFrame.depth() != CV_8U) {
+        return;
+    }
+
+    // 1. the quad: corners of the movie in the image, all in front of the
+    // camera
+    cv::Size s = movie.size();
+    double corners[4][2] = {
+        {0, 0}, {(double)s.width, 0}, {(double)s.width, (double)s.height},
+        {0, (double)s.height}};
+    cv::Point2d quad[4];
+    for (int i = 0; i < 4; i++) {
+        cv::Vec3d p = homography * cv::Vec3d(corners[i][0], corners[i][1], 1);
+        if (p[2] <= 0) {
+            return;
+        }
+        quad[i] = cv::Point2d(p[0] / p[2], p[1] / p[2]);
+    }
+
+    // 2. edges as distance functions, positive inside whatever the winding
+    WarpBlendJob job;
+    double area = 0;
+    for (int i = 0; i < 4; i++) {
+        const cv::Point2d &p = quad[i];
+        const cv::Point2d &q = quad[(i + 1) % 4];
+        area += p.x * q.y - q.x * p.y;
+    }
+    if (std::fabs(area) < 1e-9) {
+        return;
+    }
+    double orient = area > 0 ? 1 : -1;
+    for (int i = 0; i < 4; i++) {
+        cv::Point2d e = quad[(i + 1) % 4] - quad[i];
+        double len = std::sqrt(e.dot(e));
+        if (len < 1e-9) {
+            return;
+        }
+        job.edgeA[i] = -orient * e.y / len;
+        job.edgeB[i] = orient * e.x / len;
+        job.edgeC[i] = -(job.edgeA[i] * quad[i].x + job.edgeB[i] * quad[i].y);
+    }
+
+    // 3. bounding rectangle of the quad inside the image, given by the
+    // caller with distortion
+    double minX = quad[0].x, maxX = quad[0].x;
+    double minY = quad[0].y, maxY = quad[0].y;
+    for (int i = 1; i < 4; i++) {
+        minX = std::min(minX, quad[i].x);
+        maxX = std::max(maxX, quad[i].x);
+        minY = std::min(minY, quad[i].y);
+        maxY = std::max(maxY, quad[i].y);
+    }
+    int x0 = (int)std::floor(std::max(minX, 0.0));
+    int x1 = (int)std::ceil(std::min(maxX + 1, (double)dstFrame.cols));
+    int y0 = (int)std::floor(std::max(minY, 0.0));
+    int y1 = (int)std::ceil(std::min(maxY + 1, (double)dstFrame.rows));
+    if (distorted) {
+        bounds &= cv::Rect(0, 0, dstFrame.cols, dstFrame.rows);
+        x0 = bounds.x;
+        x1 = bounds.x + bounds.width;
+        y0 = bounds.y;
+        y1 = bounds.y + bounds.height;
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    // 4. sample the mip level of about the size of the quad
+    int level = movie.chooseLevel(homography);
+    job.inverse = movie.levelHomography(homography, level).inv();
+    job.texture = &movie.level(level);
+    job.xBegin = x0;
+    job.xEnd = x1;
+    job.dstFrame = &dstFrame;
+    job.undistortMap = distorted ? &undistortMap : NULL;
+
+    // 5. bands of rows on all cores
+    cv::parallel_for_(cv::Range(y0, y1), [&](const cv::Range &range) {
+        warpBlendRows(job, range.start, range.end);
+    });
+}
+
+cv::Matx33d planeHomography(const cv::Mat &calibMatrix, const cv::Mat &rotVec,
+                            const cv::Mat &transVec,
+                            const cv::Matx33d &planeFromMovie) {
+    cv::Matx33d K = calibMatrix;
+    cv::Matx33d R;
+    cv::Rodrigues(rotVec, R);
+    cv::Vec3d t = transVec;
+
+    // the z = 0 plane only needs the first two columns of R
+    cv::Matx33d pose(R(0, 0), R(0, 1), t[0], R(1, 0), R(1, 1), t[1], R(2, 0),
+                     R(2, 1), t[2]);
+    return K * pose * planeFromMovie;
+}
+
+void buildUndistortMap(const cv::Mat &calibMatrix, const cv::Mat &distortCoeff,
+                       cv::Size imageSize, cv::Mat &undistortMap) {
+    // a new buffer, the old map may be shared with a published calibration
+    undistortMap = cv::Mat(imageSize, CV_32FC2);
+
+    // bands of rows on all cores
+    cv::parallel_for_(
+        cv::Range(0, imageSize.height), [&](const cv::Range &range) {
+            // 1. every pixel of the rows
+            vector<cv::Point2f> pixels;
+            pixels.reserve((size_t)range.size() * imageSize.width);
+            for (int y = range.start; y < range.end; y++) {
+                for (int x = 0; x < imageSize.width; x++) {
+                    pixels.push_back(cv::Point2f(x, y));
+                }
+            }
+
+            // 2. undistorted, back in pixels of the same camera
+            vector<cv::Point2f> ideal;
+            cv::undistortPoints(pixels, ideal, calibMatrix, distortCoeff,
+                                cv::noArray(), calibMatrix);
+            const cv::Point2f *row = ideal.data();
+            for (int y = range.start; y < range.end; y++) {
+                std::copy(row, row + imageSize.width,
+                          undistortMap.ptr<cv::Point2f>(y));
+                row += imageSize.width;
+            }
+        });
+}
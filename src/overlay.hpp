@@ -0,0 +1,123 @@
+//**********************************************************************************************************************
+// FILE: overlay.hpp
+//
+// DESCRIPTION
+// Helpers for drawing a movie frame onto a plane of the scene: a mip pyramid
+// of the movie frame, so a quad that is small on screen is warped from a
+// level of about its size instead of the full resolution frame, and a
+// single pass warp and blend of the frame into the image.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdint.h>
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief Mip pyramid of a movie frame. Levels are only built when they are
+ * asked for, each is half the size of the one before.
+ */
+class MipPyramid {
+   public:
+    MipPyramid();
+
+    /**
+     * @brief Use a new frame as level 0. The levels already built are kept
+     * if it is the same frame as before.
+     *
+     * @param frame the movie frame
+     * @param key identifies the frame, e.g. its index in the movie
+     */
+    void reset(const cv::Mat &frame, int64_t key);
+
+    bool empty() const { return mips.empty() || mips.at(0).empty(); }
+
+    /**
+     * @brief size of level 0
+     */
+    cv::Size size() const { return empty() ? cv::Size() : mips.at(0).size(); }
+
+    /**
+     * @brief Get a level, building it and the ones before it if needed. Stops
+     * at a level of a few pixels.
+     *
+     * @param n the level wanted
+     * @return the level n, or the smallest level if n is smaller
+     */
+    const cv::Mat &level(int n);
+
+    /**
+     * @brief Pick the level to warp from: the largest one that still has at
+     * least one texel for every screen pixel everywhere on the quad.
+     *
+     * @param homography maps level 0 pixels to screen pixels
+     * @return the level
+     */
+    int chooseLevel(const cv::Matx33d &homography) const;
+
+    /**
+     * @brief The homography of a level from the one of level 0
+     *
+     * @param homography maps level 0 pixels to screen pixels
+     * @param n the level, as returned by level()
+     * @return maps level n pixels to screen pixels
+     */
+    cv::Matx33d levelHomography(const cv::Matx33d &homography, int n);
+
+   private:
+    vector<cv::Mat> mips;
+    int64_t key;
+};
+
+/**
+ * @brief Draw the movie frame on the quad it maps to in an image, with
+ * anti-aliased edges. Each pixel inside the quad is mapped back through the
+ * homography and sampled bilinearly, there is no intermediate image. Rows
+ * are split across threads.
+ *
+ * @param movie the movie frame, the level is picked from the quad size
+ * @param homography maps movie pixels (level 0) to undistorted image pixels
+ * @param dstFrame the image to draw on, same type as the movie frame
+ * @param undistortMap optional, the undistorted position of every pixel of
+ * dstFrame (see buildUndistortMap), to follow the lens distortion
+ * @param bounds the part of dstFrame the distorted quad covers, needed with
+ * undistortMap
+ */
+void compositeQuad(MipPyramid &movie, const cv::Matx33d &homography,
+                   cv::Mat &dstFrame, const cv::Mat &undistortMap = cv::Mat(),
+                   cv::Rect bounds = cv::Rect());
+
+/**
+ * @brief Homography from the pose of a plane: K [r1 r2 t] maps the z = 0
+ * plane to undistorted image pixels
+ *
+ * @param calibMatrix the calibration matrix
+ * @param rotVec the rotation vector of the plane
+ * @param transVec the translation vector of the plane
+ * @param planeFromMovie maps movie pixels to plane coordinates
+ * @return maps movie pixels to undistorted image pixels
+ */
+cv::Matx33d planeHomography(const cv::Mat &calibMatrix, const cv::Mat &rotVec,
+                            const cv::Mat &transVec,
+                            const cv::Matx33d &planeFromMovie);
+
+/**
+ * @brief For every pixel of an image, where it is without lens distortion.
+ * It is slow (a full undistortPoints per pixel), rows are split across
+ * threads.
+ *
+ * @param calibMatrix the calibration matrix
+ * @param distortCoeff the distortion coefficient
+ * @param imageSize the size of the image
+ * @param undistortMap the output, CV_32FC2 undistorted pixel positions
+ */
+void buildUndistortMap(const cv::Mat &calibMatrix, const cv::Mat &distortCoeff,
+                       cv::Size imageSize, cv::Mat &undistortMap);
+
+#endif
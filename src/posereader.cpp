@@ -0,0 +1,54 @@
+//**********************************************************************************************************************
+// FILE: posereader.cpp
+//
+// DESCRIPTION
+// Small utility that prints the poses published by calib as csv lines, as an
+// example of a consumer of the pose ring.
+// usage: posereader [shared memory name]
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "shm.hpp"
+
+int main(int argc, char *argv[]) {
+    string name = argc > 1 ? argv[1] : POSE_RING_NAME;
+
+    // 1. wait for calib to create the ring
+    PoseRingReader reader;
+    while (!reader.open(name)) {
+        fprintf(stderr, "waiting for %s...\n", name.c_str());
+        sleep(1);
+    }
+
+    // 2. follow the newest records
+    printf(
+        "frameId,timestampNs,rot_0,rot_1,rot_2,transl_0,transl_1,transl_2,"
+        "reprojError,cornerCount\n");
+    uint64_t next = reader.count();
+    for (;;) {
+        uint64_t count = reader.count();
+        if (count - next > reader.capacity()) {
+            fprintf(stderr, "skipped %llu poses\n",
+                    (unsigned long long)(count - next - reader.capacity()));
+            next = count - reader.capacity();
+        }
+        for (; next < count; next++) {
+            PoseRecord r;
+            if (!reader.read(next, r)) {
+                continue;  // overwritten while we read it
+            }
+            printf("%llu,%llu,%f,%f,%f,%f,%f,%f,%f,%d\n",
+                   (unsigned long long)r.frameId,
+                   (unsigned long long)r.timestampNs, r.rotVec[0],
+                   r.rotVec[1], r.rotVec[2], r.transVec[0], r.transVec[1],
+                   r.transVec[2], r.reprojError, r.cornerCount);
+        }
+        fflush(stdout);
+        usleep(1000);
+    }
+}
@@ -0,0 +1,278 @@
+//**********************************************************************************************************************
+// FILE: raster.cpp
+//
+// DESCRIPTION
+// Contains implementation for the software rasterizer
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core/hal/intrin.hpp>
+using namespace std;
+
+// tiles are drawn independently, each by one thread
+static const int TILE_SIZE = 32;
+
+// triangles closer to the camera than this are dropped, in chessboard squares.
+// Closer corners project far off screen and their 1 / depth swamps the
+// precision of the float z-buffer
+static const double NEAR_Z = 0.1;
+
+// light that reaches the faces turned away from the light
+static const float AMBIENT = 0.25f;
+
+/**
+ * @brief A triangle ready to be drawn
+ */
+struct ScreenTriangle {
+    float x[3], y[3];  // pixel position of the corners
+    float invZ[3];     // 1 / depth, it is linear on screen
+    cv::Vec3b color;   // shaded
+    int minX, minY, maxX, maxY;  // bounding box, inclusive
+};
+
+/**
+ * @brief Draw the part of a triangle inside a tile. Each row is done in two
+ * passes: the edge functions and depth of the span, a SIMD register of
+ * pixels at a time with 0 outside the triangle, then the depth test and the
+ * writes.
+ */
+static void drawTriangle(const ScreenTriangle &t, cv::Rect tile,
+                         cv::Point origin, cv::Mat &depth, cv::Mat &dstFrame,
+                         float *rowZ) {
+    // 1. edge functions, positive inside whatever the winding
+    float ex[3], ey[3], ec[3];  // E_i(x, y) = ex x + ey y + ec
+    for (int i = 0; i < 3; i++) {
+        int a = (i + 1) % 3, b = (i + 2) % 3;  // edge opposite corner i
+        ex[i] = -(t.y[b] - t.y[a]);
+        ey[i] = t.x[b] - t.x[a];
+        ec[i] = -(ex[i] * t.x[a] + ey[i] * t.y[a]);
+    }
+    float area = ex[0] * t.x[0] + ey[0] * t.y[0] + ec[0];
+    if (std::fabs(area) < 1e-6f) {
+        return;
+    }
+    float invArea = 1.0f / area;
+    for (int i = 0; i < 3; i++) {
+        ex[i] *= invArea;
+        ey[i] *= invArea;
+        ec[i] *= invArea;
+    }
+
+    // 2. part of the bounding box inside the tile
+    int x0 = std::max(t.minX, tile.x);
+    int x1 = std::min(t.maxX, tile.x + tile.width - 1);
+    int y0 = std::max(t.minY, tile.y);
+    int y1 = std::min(t.maxY, tile.y + tile.height - 1);
+    int n = x1 - x0 + 1;
+    if (n <= 0) {
+        return;
+    }
+
+#if CV_SIMD
+    // lane j of the registers is pixel k + j of the row
+    const int lanes = cv::v_float32::nlanes;
+    float offsets[cv::v_float32::nlanes];
+    for (int j = 0; j < lanes; j++) {
+        offsets[j] = (float)j;
+    }
+    const cv::v_float32 vStep = cv::vx_setall_f32((float)lanes);
+    const cv::v_float32 vZero = cv::vx_setall_f32(0.0f);
+    cv::v_float32 vex[3], vInvZ[3];
+    for (int i = 0; i < 3; i++) {
+        vex[i] = cv::vx_setall_f32(ex[i]);
+        vInvZ[i] = cv::vx_setall_f32(t.invZ[i]);
+    }
+#endif
+
+    for (int y = y0; y <= y1; y++) {
+        // 3. barycentric coordinates and depth along the row, 0 (infinitely
+        // far) outside the triangle
+        float l0 = ex[0] * x0 + ey[0] * y + ec[0];
+        float l1 = ex[1] * x0 + ey[1] * y + ec[1];
+        float l2 = ex[2] * x0 + ey[2] * y + ec[2];
+        int k = 0;
+#if CV_SIMD
+        cv::v_float32 vk = cv::vx_load(offsets);
+        cv::v_float32 vl0 = cv::vx_setall_f32(l0);
+        cv::v_float32 vl1 = cv::vx_setall_f32(l1);
+        cv::v_float32 vl2 = cv::vx_setall_f32(l2);
+        for (; k <= n - lanes; k += lanes, vk = vk + vStep) {
+            cv::v_float32 b0 = vl0 + vex[0] * vk;
+            cv::v_float32 b1 = vl1 + vex[1] * vk;
+            cv::v_float32 b2 = vl2 + vex[2] * vk;
+            cv::v_float32 inside = (b0 >= vZero) & (b1 >= vZero) &
+                                   (b2 >= vZero);
+            cv::v_float32 z = b0 * vInvZ[0] + b1 * vInvZ[1] + b2 * vInvZ[2];
+            cv::v_store(rowZ + k, cv::v_select(inside, z, vZero));
+        }
+#endif
+        for (; k < n; k++) {
+            float b0 = l0 + ex[0] * k;
+            float b1 = l1 + ex[1] * k;
+            float b2 = l2 + ex[2] * k;
+            bool inside = b0 >= 0 && b1 >= 0 && b2 >= 0;
+            rowZ[k] = inside ? b0 * t.invZ[0] + b1 * t.invZ[1] +
+                                   b2 * t.invZ[2]
+                             : 0.0f;
+        }
+
+        // 4. keep the nearest, the largest 1 / depth
+        float *z = depth.ptr<float>(y - origin.y) + (x0 - origin.x);
+        cv::Vec3b *out = dstFrame.ptr<cv::Vec3b>(y) + x0;
+        for (k = 0; k < n; k++) {
+            if (rowZ[k] > z[k]) {
+                z[k] = rowZ[k];
+                out[k] = t.color;
+            }
+        }
+    }
+}
+
+void transformVertices(const vector<cv::Point3f> &vertices,
+                       const cv::Mat &rotVec, const cv::Mat &transVec,
+                       vector<cv::Vec3f> &camera) {
+    cv::Matx33d R;
+    cv::Rodrigues(rotVec, R);
+    cv::Vec3d t = transVec;
+    int numVertices = vertices.size();
+    camera.resize(numVertices);
+    cv::parallel_for_(cv::Range(0, numVertices), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++) {
+            const cv::Point3f &v = vertices.at(i);
+            camera.at(i) = R * cv::Vec3d(v.x, v.y, v.z) + t;
+        }
+    });
+}
+
+void rasterizeMesh(const Mesh &mesh, const cv::Mat &rotVec,
+                   const cv::Mat &transVec, const cv::Mat &calibMatrix,
+                   const cv::Mat &distortCoeff, cv::Scalar color,
+                   cv::Mat &dstFrame) {
+    if (mesh.vertices.empty() || dstFrame.type() != CV_8UC3) {
+        return;
+    }
+
+    // 1. corners in camera coordinates and on screen
+    vector<cv::Vec3f> camera;
+    transformVertices(mesh.vertices, rotVec, transVec, camera);
+    vector<cv::Point2f> screen;
+    cv::projectPoints(mesh.vertices, rotVec, transVec, calibMatrix,
+                      distortCoeff, screen);
+
+    // 2. shade the triangles and drop the ones behind the camera or off
+    // screen
+    int numTriangles = mesh.triangles.size();
+    vector<ScreenTriangle> triangles(numTriangles);
+    vector<unsigned char> visible(numTriangles, 0);
+    cv::Rect frame(0, 0, dstFrame.cols, dstFrame.rows);
+    cv::parallel_for_(
+        cv::Range(0, numTriangles), [&](const cv::Range &range) {
+            for (int f = range.start; f < range.end; f++) {
+                const cv::Vec3i &face = mesh.triangles.at(f);
+                ScreenTriangle &st = triangles.at(f);
+                float minX = HUGE_VALF, maxX = -HUGE_VALF;
+                float minY = HUGE_VALF, maxY = -HUGE_VALF;
+                bool inFront = true;
+                for (int k = 0; k < 3; k++) {
+                    const cv::Vec3f &c = camera.at(face[k]);
+                    const cv::Point2f &p = screen.at(face[k]);
+                    inFront = inFront && c[2] > NEAR_Z &&
+                              std::isfinite(p.x) && std::isfinite(p.y);
+                    st.x[k] = p.x;
+                    st.y[k] = p.y;
+                    st.invZ[k] = 1.0f / c[2];
+                    minX = std::min(minX, p.x);
+                    maxX = std::max(maxX, p.x);
+                    minY = std::min(minY, p.y);
+                    maxY = std::max(maxY, p.y);
+                }
+                if (!inFront || maxX < 0 || maxY < 0 || minX >= frame.width ||
+                    minY >= frame.height) {
+                    continue;
+                }
+                // - clamp while still float, a corner far off screen does
+                // not fit in an int
+                st.minX = (int)std::ceil(std::max(minX, 0.0f));
+                st.minY = (int)std::ceil(std::max(minY, 0.0f));
+                st.maxX = (int)std::floor(
+                    std::min(maxX, (float)(frame.width - 1)));
+                st.maxY = (int)std::floor(
+                    std::min(maxY, (float)(frame.height - 1)));
+                if (st.minX > st.maxX || st.minY > st.maxY) {
+                    continue;  // between pixel centers
+                }
+
+                // - flat Lambert shading, light along the camera axis so a
+                // flat face gets one color, both sides lit
+                const cv::Vec3f &c0 = camera.at(face[0]);
+                cv::Vec3f normal =
+                    (camera.at(face[1]) - c0).cross(camera.at(face[2]) - c0);
+                float length = cv::norm(normal);
+                float lambert = length > 0 ? std::fabs(normal[2]) / length : 0;
+                float light = AMBIENT + (1 - AMBIENT) * lambert;
+                st.color = cv::Vec3b(cv::saturate_cast<uchar>(color[0] * light),
+                                     cv::saturate_cast<uchar>(color[1] * light),
+                                     cv::saturate_cast<uchar>(color[2] * light));
+                visible.at(f) = 1;
+            }
+        });
+
+    // 3. region of the image the mesh covers
+    cv::Rect region;
+    for (int f = 0; f < numTriangles; f++) {
+        if (visible.at(f)) {
+            const ScreenTriangle &st = triangles.at(f);
+            cv::Rect box(st.minX, st.minY, st.maxX - st.minX + 1,
+                         st.maxY - st.minY + 1);
+            region = region.empty() ? box : (region | box);
+        }
+    }
+    if (region.empty()) {
+        return;
+    }
+
+    // 4. bin the triangles by tile, in mesh order
+    int tilesX = (region.width + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesY = (region.height + TILE_SIZE - 1) / TILE_SIZE;
+    vector<vector<int>> bins(tilesX * tilesY);
+    for (int f = 0; f < numTriangles; f++) {
+        if (!visible.at(f)) {
+            continue;
+        }
+        const ScreenTriangle &st = triangles.at(f);
+        int tx0 = (st.minX - region.x) / TILE_SIZE;
+        int tx1 = (st.maxX - region.x) / TILE_SIZE;
+        int ty0 = (st.minY - region.y) / TILE_SIZE;
+        int ty1 = (st.maxY - region.y) / TILE_SIZE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                bins.at(ty * tilesX + tx).push_back(f);
+            }
+        }
+    }
+
+    // 5. draw the tiles on all cores, the z-buffer covers the region and
+    // holds 1 / depth, 0 is infinitely far
+    cv::Mat depth = cv::Mat::zeros(region.size(), CV_32F);
+    cv::parallel_for_(cv::Range(0, bins.size()), [&](const cv::Range &range) {
+        vector<float> rowZ(TILE_SIZE);
+        for (int b = range.start; b < range.end; b++) {
+            cv::Rect tile(region.x + (b % tilesX) * TILE_SIZE,
+                          region.y + (b / tilesX) * TILE_SIZE, TILE_SIZE,
+                          TILE_SIZE);
+            tile &= region;
+            for (int f : bins.at(b)) {
+                drawTriangle(triangles.at(f), tile, region.tl(), depth,
+                             dstFrame, rowZ.data());
+            }
+        }
+    });
+}
@@ -0,0 +1,50 @@
+//**********************************************************************************************************************
+// FILE: raster.hpp
+//
+// DESCRIPTION
+// Software rasterizer for the virtual objects: filled triangles with a
+// z-buffer and flat Lambert shading. The part of the image the mesh covers
+// is cut in tiles, every tile gets the triangles that overlap it and the
+// tiles are drawn on all cores.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <opencv2/opencv.hpp>
+
+#include "mesh.hpp"
+
+/**
+ * @brief Move the vertices of a mesh from chessboard to camera coordinates,
+ * on all cores
+ *
+ * @param vertices the vertices, in chessboard coordinates
+ * @param rotVec the rotation vector of the chessboard
+ * @param transVec the translation vector of the chessboard
+ * @param camera the output vertices, z is the depth
+ */
+void transformVertices(const vector<cv::Point3f> &vertices,
+                       const cv::Mat &rotVec, const cv::Mat &transVec,
+                       vector<cv::Vec3f> &camera);
+
+/**
+ * @brief Draw a mesh with filled, shaded triangles. The light comes from the
+ * camera, so the faces turned towards the camera are the brightest.
+ *
+ * @param mesh the triangles, in chessboard coordinates
+ * @param rotVec the rotation vector of the chessboard
+ * @param transVec the translation vector of the chessboard
+ * @param calibMatrix the calibration matrix
+ * @param distortCoeff the distortion coefficient
+ * @param color the color of a fully lit face
+ * @param dstFrame the CV_8UC3 image to draw on
+ */
+void rasterizeMesh(const Mesh &mesh, const cv::Mat &rotVec,
+                   const cv::Mat &transVec, const cv::Mat &calibMatrix,
+                   const cv::Mat &distortCoeff, cv::Scalar color,
+                   cv::Mat &dstFrame);
+
+#endif
@@ -0,0 +1,98 @@
+//**********************************************************************************************************************
+// FILE: reprojection.cpp
+//
+// DESCRIPTION
+// Contains implementation for the reprojection error analysis
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "reprojection.hpp"
+
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+// an outlier view must also be this many times worse than the median view
+static const double MEDIAN_FACTOR = 3.0;
+
+void computeReprojectionErrors(
+    const vector<vector<cv::Point3f>> &listWorldPoints,
+    const vector<vector<cv::Point2f>> &listImagePoints,
+    const cv::Mat &calibMatrix, const cv::Mat &distortCoeff,
+    const vector<cv::Mat> &rotationVecs, const vector<cv::Mat> &translVecs,
+    vector<ViewError> &viewErrors) {
+    viewErrors.resize(listImagePoints.size());
+
+    cv::parallel_for_(
+        cv::Range(0, listImagePoints.size()), [&](const cv::Range &range) {
+            for (int i = range.start; i < range.end; i++) {
+                const vector<cv::Point2f> &imagePoints = listImagePoints.at(i);
+                vector<cv::Point2f> projected;
+                cv::projectPoints(listWorldPoints.at(i), rotationVecs.at(i),
+                                  translVecs.at(i), calibMatrix, distortCoeff,
+                                  projected);
+
+                ViewError &viewError = viewErrors.at(i);
+                viewError.maxError = 0;
+                viewError.worstCorner = 0;
+                double sqSum = 0;
+                for (int k = 0; k < imagePoints.size(); k++) {
+                    double err = cv::norm(projected.at(k) - imagePoints.at(k));
+                    sqSum += err * err;
+                    if (err > viewError.maxError) {
+                        viewError.maxError = err;
+                        viewError.worstCorner = k;
+                    }
+                }
+                viewError.rms =
+                    imagePoints.empty() ? 0
+                                        : std::sqrt(sqSum / imagePoints.size());
+            }
+        });
+}
+
+double poseReprojectionError(const vector<cv::Point3f> &worldPoints,
+                             const vector<cv::Point2f> &imagePoints,
+                             const cv::Mat &calibMatrix,
+                             const cv::Mat &distortCoeff,
+                             const cv::Mat &rotVec, const cv::Mat &transVec) {
+    if (imagePoints.empty()) {
+        return 0;
+    }
+    vector<cv::Point2f> projected;
+    cv::projectPoints(worldPoints, rotVec, transVec, calibMatrix, distortCoeff,
+                      projected);
+    double sqSum = 0;
+    for (int k = 0; k < imagePoints.size(); k++) {
+        cv::Point2f d = projected.at(k) - imagePoints.at(k);
+        sqSum += d.x * d.x + d.y * d.y;
+    }
+    return std::sqrt(sqSum / imagePoints.size());
+}
+
+vector<int> findOutlierViews(const vector<ViewError> &viewErrors,
+                             double threshold) {
+    vector<int> outliers;
+    if (viewErrors.empty() || threshold <= 0) {
+        return outliers;
+    }
+
+    // 1. median view error
+    vector<double> rms;
+    for (int i = 0; i < viewErrors.size(); i++) {
+        rms.push_back(viewErrors.at(i).rms);
+    }
+    std::nth_element(rms.begin(), rms.begin() + rms.size() / 2, rms.end());
+    double median = rms.at(rms.size() / 2);
+
+    // 2. views above both limits
+    double limit = std::max(threshold, MEDIAN_FACTOR * median);
+    for (int i = 0; i < viewErrors.size(); i++) {
+        if (viewErrors.at(i).rms > limit) {
+            outliers.push_back(i);
+        }
+    }
+    return outliers;
+}
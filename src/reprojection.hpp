@@ -0,0 +1,77 @@
+//**********************************************************************************************************************
+// FILE: reprojection.hpp
+//
+// DESCRIPTION
+// Contains functions for measuring how well a calibration explains every view
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef REPROJECTION_H
+#define REPROJECTION_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "filter.hpp"
+
+/**
+ * @brief The reprojection error of a single view
+ */
+struct ViewError {
+    double rms;       // rms error over the corners of the view, in pixels
+    double maxError;  // largest corner error
+    int worstCorner;  // index of the corner with the largest error
+};
+
+/**
+ * @brief Project the chessboard of every view with its calibrated pose and
+ * measure the distance to the detected corners. The views are processed in
+ * parallel.
+ *
+ * @param listWorldPoints the list of 3D points of the chessboard
+ * @param listImagePoints the list of 2D points of the chessboard
+ * @param calibMatrix the calibration matrix
+ * @param distortCoeff the distortion coefficient
+ * @param rotationVecs the rotation of every view
+ * @param translVecs the translation of every view
+ * @param viewErrors the output error of every view
+ */
+void computeReprojectionErrors(
+    const vector<vector<cv::Point3f>> &listWorldPoints,
+    const vector<vector<cv::Point2f>> &listImagePoints,
+    const cv::Mat &calibMatrix, const cv::Mat &distortCoeff,
+    const vector<cv::Mat> &rotationVecs, const vector<cv::Mat> &translVecs,
+    vector<ViewError> &viewErrors);
+
+/**
+ * @brief The rms reprojection error of a single pose, e.g. the pose of the
+ * current video frame
+ *
+ * @param worldPoints the 3D points of the chessboard
+ * @param imagePoints the detected 2D points
+ * @param calibMatrix the calibration matrix
+ * @param distortCoeff the distortion coefficient
+ * @param rotVec the rotation of the pose
+ * @param transVec the translation of the pose
+ * @return double the rms error in pixels
+ */
+double poseReprojectionError(const vector<cv::Point3f> &worldPoints,
+                             const vector<cv::Point2f> &imagePoints,
+                             const cv::Mat &calibMatrix,
+                             const cv::Mat &distortCoeff,
+                             const cv::Mat &rotVec, const cv::Mat &transVec);
+
+/**
+ * @brief Pick the views whose rms error is above threshold and also well
+ * above the median view, so a camera that is just noisy does not lose all its
+ * views.
+ *
+ * @param viewErrors the error of every view
+ * @param threshold the rms error in pixels above which a view is an outlier
+ * @return vector<int> the indices of the outlier views
+ */
+vector<int> findOutlierViews(const vector<ViewError> &viewErrors,
+                             double threshold);
+
+#endif
@@ -0,0 +1,312 @@
+//**********************************************************************************************************************
+// FILE: shm.cpp
+//
+// DESCRIPTION
+// Contains implementation for the shared memory outputs
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "shm.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <new>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory needs lock-free 64 bit atomics");
+
+// >>>>>>>>>>> Region
+ShmRegion::ShmRegion() : ptr(NULL), length(0), owner(false) {}
+
+ShmRegion::~ShmRegion() { close(); }
+
+/**
+ * @brief true if the object was left behind by a process that is gone, or
+ * was not made by ShmRegion at all
+ */
+static bool isStale(const string &regionName) {
+    ShmRegion existing;
+    if (!existing.open(regionName, false)) {
+        return true;  // too small for an owner block
+    }
+    const ShmOwner *owner =
+        (const ShmOwner *)((const char *)existing.data() - SHM_OWNER_SIZE);
+    if (memcmp(owner->magic, "SHMO", 4) != 0) {
+        return true;
+    }
+    // - signal 0 only checks the process exists
+    return kill(owner->pid, 0) != 0 && errno == ESRCH;
+}
+
+bool ShmRegion::create(const string &regionName, size_t size) {
+    close();
+
+    // 1. a previous run that crashed may have left it behind, a running one
+    // keeps it
+    int fd = shm_open(regionName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        if (!isStale(regionName)) {
+            printf("shared memory %s is used by another running process\n",
+                   regionName.c_str());
+            return false;
+        }
+        shm_unlink(regionName.c_str());
+        fd = shm_open(regionName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) {
+        printf("Unable to create shared memory %s\n", regionName.c_str());
+        return false;
+    }
+    size_t total = SHM_OWNER_SIZE + size;
+    if (ftruncate(fd, total) != 0) {
+        ::close(fd);
+        shm_unlink(regionName.c_str());
+        return false;
+    }
+
+    // 2. map it
+    void *p = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(regionName.c_str());
+        return false;
+    }
+
+    // 3. claim it, the magic goes last
+    ShmOwner *block = (ShmOwner *)p;
+    block->pid = getpid();
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(block->magic, "SHMO", 4);
+
+    name = regionName;
+    ptr = p;
+    length = total;
+    owner = true;
+    return true;
+}
+
+bool ShmRegion::open(const string &regionName, bool writable) {
+    close();
+
+    int fd = shm_open(regionName.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat buffer;
+    if (fstat(fd, &buffer) != 0 ||
+        (size_t)buffer.st_size < SHM_OWNER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *p = mmap(NULL, buffer.st_size, prot, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    name = regionName;
+    ptr = p;
+    length = buffer.st_size;
+    owner = false;
+    return true;
+}
+
+void ShmRegion::close() {
+    if (ptr) {
+        munmap(ptr, length);
+        if (owner) {
+            shm_unlink(name.c_str());
+        }
+    }
+    ptr = NULL;
+    length = 0;
+    owner = false;
+}
+
+// >>>>>>>>>>> Pose ring
+bool PoseRingWriter::create(const string &name, uint32_t capacity) {
+    size_t size = sizeof(PoseRingHeader) + capacity * sizeof(PoseSlot);
+    if (capacity == 0 || !region.create(name, size)) {
+        return false;
+    }
+
+    // the new object is zero filled, construct the atomics in place
+    header = new (region.data()) PoseRingHeader;
+    slots = (PoseSlot *)(header + 1);
+    for (uint32_t i = 0; i < capacity; i++) {
+        new (&slots[i].seq) std::atomic<uint64_t>(0);
+    }
+    header->version = POSE_RING_VERSION;
+    header->capacity = capacity;
+    header->recordSize = sizeof(PoseRecord);
+    header->count.store(0);
+
+    // the magic goes last, readers check it first
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, "POSE", 4);
+    return true;
+}
+
+void PoseRingWriter::publish(const PoseRecord &record) {
+    if (!header) {
+        return;
+    }
+    uint64_t n = header->count.load(std::memory_order_relaxed);
+    PoseSlot &slot = slots[n % header->capacity];
+
+    // seqlock: odd while writing, 2 * (n + 1) once done
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record = record;
+    slot.seq.store(2 * (n + 1), std::memory_order_release);
+    header->count.store(n + 1, std::memory_order_release);
+}
+
+bool PoseRingReader::open(const string &name) {
+    if (!region.open(name, false) || region.size() < sizeof(PoseRingHeader)) {
+        return false;
+    }
+    header = (PoseRingHeader *)region.data();
+    slots = (PoseSlot *)(header + 1);
+    return memcmp(header->magic, "POSE", 4) == 0 &&
+           header->version == POSE_RING_VERSION &&
+           header->recordSize == sizeof(PoseRecord) &&
+           region.size() >=
+               sizeof(PoseRingHeader) + header->capacity * sizeof(PoseSlot);
+}
+
+uint64_t PoseRingReader::count() const {
+    return header->count.load(std::memory_order_acquire);
+}
+
+bool PoseRingReader::read(uint64_t n, PoseRecord &record) const {
+    const PoseSlot &slot = slots[n % header->capacity];
+    uint64_t before = slot.seq.load(std::memory_order_acquire);
+    if (before != 2 * (n + 1)) {
+        return false;  // not written yet, being written or overwritten
+    }
+    record = slot.record;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == before;
+}
+
+// >>>>>>>>>>> Frame ring
+// pixels of every slot start on their own page
+static const size_t FRAME_ALIGN = 4096;
+
+static size_t alignUp(size_t n) {
+    return (n + FRAME_ALIGN - 1) / FRAME_ALIGN * FRAME_ALIGN;
+}
+
+bool FrameRingWriter::create(const string &name, uint32_t slotCount,
+                             size_t slotBytes) {
+    if (slotCount == 0 || slotBytes == 0) {
+        return false;
+    }
+
+    // 1. header and slot table, then the pixels
+    size_t dataStart =
+        alignUp(sizeof(FrameRingHeader) + slotCount * sizeof(FrameSlot));
+    size_t slotSize = alignUp(slotBytes);
+    if (!region.create(name, dataStart + slotCount * slotSize)) {
+        return false;
+    }
+
+    // 2. construct the atomics in place
+    header = new (region.data()) FrameRingHeader;
+    slots = (FrameSlot *)(header + 1);
+    for (uint32_t i = 0; i < slotCount; i++) {
+        new (&slots[i].seq) std::atomic<uint64_t>(0);
+        slots[i].dataOffset = dataStart + i * slotSize;
+    }
+    header->version = FRAME_RING_VERSION;
+    header->slotCount = slotCount;
+    header->slotBytes = slotSize;
+    header->count.store(0);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, "FRMS", 4);
+    return true;
+}
+
+bool FrameRingWriter::publish(const FrameInfo &info, const void *data,
+                              size_t srcStep) {
+    if (!header || info.step <= 0 ||
+        (uint64_t)info.step * info.height > header->slotBytes) {
+        return false;
+    }
+    uint64_t n = header->count.load(std::memory_order_relaxed);
+    FrameSlot &slot = slots[n % header->slotCount];
+
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.info = info;
+    char *dst = (char *)region.data() + slot.dataOffset;
+    const char *src = (const char *)data;
+    if (srcStep == (size_t)info.step) {
+        memcpy(dst, src, (size_t)info.step * info.height);
+    } else {
+        for (int y = 0; y < info.height; y++) {
+            memcpy(dst + (size_t)y * info.step, src + y * srcStep, info.step);
+        }
+    }
+    slot.seq.store(2 * (n + 1), std::memory_order_release);
+    header->count.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+bool FrameRingReader::open(const string &name) {
+    if (!region.open(name, false) ||
+        region.size() < sizeof(FrameRingHeader)) {
+        return false;
+    }
+    header = (const FrameRingHeader *)region.data();
+    slots = (const FrameSlot *)(header + 1);
+    if (memcmp(header->magic, "FRMS", 4) != 0 ||
+        header->version != FRAME_RING_VERSION) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header->slotCount; i++) {
+        if (slots[i].dataOffset + header->slotBytes > region.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t FrameRingReader::count() const {
+    return header->count.load(std::memory_order_acquire);
+}
+
+bool FrameRingReader::acquire(uint64_t n, FrameInfo &info,
+                              const void *&data) const {
+    const FrameSlot &slot = slots[n % header->slotCount];
+    if (slot.seq.load(std::memory_order_acquire) != 2 * (n + 1)) {
+        return false;
+    }
+    info = slot.info;
+    data = (const char *)region.data() + slot.dataOffset;
+    return valid(n);
+}
+
+bool FrameRingReader::valid(uint64_t n) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const FrameSlot &slot = slots[n % header->slotCount];
+    return slot.seq.load(std::memory_order_relaxed) == 2 * (n + 1);
+}
+
+uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,284 @@
+//**********************************************************************************************************************
+// FILE: shm.hpp
+//
+// DESCRIPTION
+// Shared memory outputs for other processes on the same machine. The poses
+// and the video frames are published in lock-free rings: one writer, any
+// number of readers that never block the writer. Every slot has a sequence
+// number (seqlock), a reader uses a slot and then checks the sequence number
+// did not change meanwhile.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef SHM_H
+#define SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+using namespace std;
+
+/**
+ * @brief Written at the start of every object by its creator, so another
+ * creator can tell a live object from one left behind by a crash
+ */
+struct ShmOwner {
+    char magic[4];  // "SHMO", written after pid
+    int32_t pid;    // process that created the object
+};
+
+// the owner block has the first page, the data starts page aligned after it
+static const size_t SHM_OWNER_SIZE = 4096;
+
+/**
+ * @brief A POSIX shared memory object mapped into this process
+ */
+class ShmRegion {
+   public:
+    ShmRegion();
+    ~ShmRegion();
+
+    /**
+     * @brief Create the object and map it read-write. An object of the same
+     * name is only replaced if the process that created it is gone,
+     * otherwise this fails. It is unlinked again by close, readers that
+     * mapped it keep it.
+     *
+     * @param name the name of the object, starting with '/'
+     * @param size the size in bytes, not counting the owner block
+     * @return true if successful
+     */
+    bool create(const string &name, size_t size);
+
+    /**
+     * @brief Map an existing object
+     *
+     * @param name the name of the object, starting with '/'
+     * @param writable true to map it read-write
+     * @return true if successful
+     */
+    bool open(const string &name, bool writable);
+    void close();
+
+    // after the owner block
+    void *data() const { return ptr ? (char *)ptr + SHM_OWNER_SIZE : NULL; }
+    size_t size() const { return ptr ? length - SHM_OWNER_SIZE : 0; }
+
+   private:
+    string name;
+    void *ptr;
+    size_t length;
+    bool owner;  // we created it, unlink on close
+};
+
+static const char POSE_RING_NAME[] = "/calib_pose";
+static const uint32_t POSE_RING_VERSION = 1;
+
+/**
+ * @brief One camera pose. Fixed size so it can live in shared memory
+ */
+struct PoseRecord {
+    uint64_t frameId;      // index of the camera frame
+    uint64_t timestampNs;  // capture time, CLOCK_MONOTONIC in nanoseconds
+    double rotVec[3];      // rotation vector (Rodrigues)
+    double transVec[3];    // translation vector, in chessboard squares
+    double reprojError;    // rms reprojection error of the corners, pixels
+    int32_t cornerCount;   // number of corners used
+    int32_t reserved;
+};
+
+struct PoseSlot {
+    // 2 * (record number + 1) once written, odd while being written
+    std::atomic<uint64_t> seq;
+    PoseRecord record;
+};
+
+struct PoseRingHeader {
+    char magic[4];  // "POSE"
+    uint32_t version;
+    uint32_t capacity;    // number of slots
+    uint32_t recordSize;  // sizeof(PoseRecord)
+    std::atomic<uint64_t> count;  // number of records written so far
+    // followed by capacity PoseSlot
+};
+
+/**
+ * @brief The writing side of the pose ring
+ */
+class PoseRingWriter {
+   public:
+    /**
+     * @brief Create the ring in shared memory
+     *
+     * @param name the name of the shared memory object
+     * @param capacity the number of records kept
+     * @return true if successful
+     */
+    bool create(const string &name, uint32_t capacity);
+
+    /**
+     * @brief Write a record, overwriting the oldest one. Never blocks.
+     */
+    void publish(const PoseRecord &record);
+
+   private:
+    ShmRegion region;
+    PoseRingHeader *header = NULL;
+    PoseSlot *slots = NULL;
+};
+
+/**
+ * @brief The reading side of the pose ring
+ */
+class PoseRingReader {
+   public:
+    /**
+     * @brief Attach to a ring created by a PoseRingWriter
+     *
+     * @param name the name of the shared memory object
+     * @return true if the ring exists and has the same version
+     */
+    bool open(const string &name);
+
+    /**
+     * @brief number of records written so far, the newest one is count() - 1
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Read record number n
+     *
+     * @param n the record number
+     * @param record the output record
+     * @return true if it was read, false if it is not written yet or was
+     * already overwritten
+     */
+    bool read(uint64_t n, PoseRecord &record) const;
+
+    uint32_t capacity() const { return header->capacity; }
+
+   private:
+    ShmRegion region;
+    PoseRingHeader *header = NULL;
+    PoseSlot *slots = NULL;
+};
+
+static const char FRAME_RING_NAME[] = "/calib_frames";
+static const char SOURCE_RING_NAME[] = "/calib_source";
+static const uint32_t FRAME_RING_VERSION = 1;
+
+/**
+ * @brief Describes the frame stored in a slot of the frame ring
+ */
+struct FrameInfo {
+    uint64_t frameId;
+    uint64_t timestampNs;  // capture time, CLOCK_MONOTONIC in nanoseconds
+    int32_t width;
+    int32_t height;
+    int32_t type;  // OpenCV type, e.g. CV_8UC3
+    int32_t step;  // bytes per row, rows are packed
+};
+
+struct FrameSlot {
+    // 2 * (frame number + 1) once written, odd while being written
+    std::atomic<uint64_t> seq;
+    FrameInfo info;
+    uint64_t dataOffset;  // from the start of the region
+};
+
+struct FrameRingHeader {
+    char magic[4];  // "FRMS"
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t reserved;
+    uint64_t slotBytes;           // largest frame a slot can hold
+    std::atomic<uint64_t> count;  // number of frames written so far
+    // followed by slotCount FrameSlot, then the pixels of every slot
+};
+
+/**
+ * @brief The writing side of the frame ring. The frame is copied once into
+ * shared memory, readers use it from there.
+ */
+class FrameRingWriter {
+   public:
+    /**
+     * @brief Create the ring in shared memory
+     *
+     * @param name the name of the shared memory object
+     * @param slotCount the number of frames kept, a reader has about
+     * slotCount - 1 frame times to use a frame before it is overwritten
+     * @param slotBytes the largest frame in bytes
+     * @return true if successful
+     */
+    bool create(const string &name, uint32_t slotCount, size_t slotBytes);
+
+    /**
+     * @brief Write a frame into the oldest slot. Never blocks.
+     *
+     * @param info the size and type of the frame
+     * @param data the first row
+     * @param srcStep bytes between the rows in data
+     * @return false if the frame does not fit in a slot
+     */
+    bool publish(const FrameInfo &info, const void *data, size_t srcStep);
+
+    bool isOpen() const { return header != NULL; }
+
+   private:
+    ShmRegion region;
+    FrameRingHeader *header = NULL;
+    FrameSlot *slots = NULL;
+};
+
+/**
+ * @brief The reading side of the frame ring. Readers use the pixels in place:
+ * acquire a frame, process it, then check it is still valid.
+ */
+class FrameRingReader {
+   public:
+    /**
+     * @brief Attach to a ring created by a FrameRingWriter
+     *
+     * @param name the name of the shared memory object
+     * @return true if the ring exists and has the same version
+     */
+    bool open(const string &name);
+
+    /**
+     * @brief number of frames written so far, the newest one is count() - 1
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Get frame number n without copying it
+     *
+     * @param n the frame number
+     * @param info the output size and type
+     * @param data the output pointer to the pixels in shared memory
+     * @return false if the frame is not written yet or was overwritten
+     */
+    bool acquire(uint64_t n, FrameInfo &info, const void *&data) const;
+
+    /**
+     * @brief true if frame number n was not overwritten since acquire. Call
+     * it after using the pixels, if false they may be torn.
+     */
+    bool valid(uint64_t n) const;
+
+   private:
+    ShmRegion region;
+    const FrameRingHeader *header = NULL;
+    const FrameSlot *slots = NULL;
+};
+
+/**
+ * @brief CLOCK_MONOTONIC in nanoseconds, the clock of every timestamp
+ * published in shared memory
+ */
+uint64_t monotonicNs();
+
+#endif
@@ -0,0 +1,407 @@
+//**********************************************************************************************************************
+// FILE: simplify.cpp
+//
+// DESCRIPTION
+// Contains implementation for the mesh simplification and levels of detail
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+// each level of detail has about this part of the triangles of the one before
+static const double LOD_RATIO = 0.25;
+
+// no level of detail is made with fewer triangles
+static const size_t MIN_LOD_TRIANGLES = 256;
+
+static const int MAX_LODS = 4;
+
+// area of the image, in pixels, a triangle should cover at least
+static const double PIXELS_PER_TRIANGLE = 4;
+
+// the border of an open mesh is this much harder to move than its surface
+static const double BORDER_WEIGHT = 1000;
+
+// a collapse is skipped if a triangle turns more than about 80 degrees
+static const double MIN_NORMAL_COS = 0.2;
+
+/**
+ * @brief Sum of squared distances to a set of planes, as a symmetric 4x4
+ * matrix. Only the upper half is stored.
+ */
+struct Quadric {
+    double q[10] = {0};
+
+    Quadric() {}
+
+    // plane a x + b y + c z + d = 0, with a unit normal
+    Quadric(double a, double b, double c, double d, double weight) {
+        double p[4] = {a, b, c, d};
+        int k = 0;
+        for (int i = 0; i < 4; i++) {
+            for (int j = i; j < 4; j++) {
+                q[k++] = weight * p[i] * p[j];
+            }
+        }
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        for (int k = 0; k < 10; k++) {
+            q[k] += other.q[k];
+        }
+        return *this;
+    }
+
+    double error(const cv::Vec3d &v) const {
+        double x = v[0], y = v[1], z = v[2];
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z +
+               2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+               q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+
+    // point of least error, false if there is no single one
+    bool minimum(cv::Vec3d &v) const {
+        cv::Matx33d A(q[0], q[1], q[2], q[1], q[4], q[5], q[2], q[5], q[7]);
+        cv::Vec3d b(-q[3], -q[6], -q[8]);
+        return cv::solve(A, b, v, cv::DECOMP_LU);
+    }
+};
+
+/**
+ * @brief Collapse of edge ab into one vertex. It is out of date if a or b
+ * changed since it was queued.
+ */
+struct Collapse {
+    double cost;
+    int a, b;
+    unsigned stampA, stampB;
+    cv::Vec3d position;
+
+    bool operator<(const Collapse &other) const { return cost > other.cost; }
+};
+
+static cv::Vec3d triangleNormal(const cv::Vec3d &p0, const cv::Vec3d &p1,
+                                const cv::Vec3d &p2) {
+    return (p1 - p0).cross(p2 - p0);
+}
+
+/**
+ * @brief True if moving vertex a to position folds over one of the
+ * triangles around a that do not also hold b
+ */
+static bool foldsOver(int a, int b, const cv::Vec3d &position,
+                      const vector<cv::Vec3d> &positions,
+                      const vector<cv::Vec3i> &faces,
+                      const vector<int> &aroundA) {
+    for (int f : aroundA) {
+        const cv::Vec3i &t = faces.at(f);
+        if (t[0] == b || t[1] == b || t[2] == b) {
+            continue;
+        }
+        cv::Vec3d before[3], after[3];
+        for (int k = 0; k < 3; k++) {
+            before[k] = positions.at(t[k]);
+            after[k] = t[k] == a ? position : before[k];
+        }
+        cv::Vec3d n0 = triangleNormal(before[0], before[1], before[2]);
+        cv::Vec3d n1 = triangleNormal(after[0], after[1], after[2]);
+        double norms = cv::norm(n0) * cv::norm(n1);
+        if (norms > 0 && n0.dot(n1) < MIN_NORMAL_COS * norms) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Corners other than v of the living triangles around v, sorted
+ */
+static void ringOf(int v, const vector<cv::Vec3i> &faces,
+                   const vector<unsigned char> &faceAlive,
+                   const vector<int> &aroundV, vector<int> &ring) {
+    ring.clear();
+    for (int f : aroundV) {
+        if (!faceAlive.at(f)) {
+            continue;
+        }
+        for (int k = 0; k < 3; k++) {
+            if (faces.at(f)[k] != v) {
+                ring.push_back(faces.at(f)[k]);
+            }
+        }
+    }
+    std::sort(ring.begin(), ring.end());
+    ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+}
+
+/**
+ * @brief Link condition: a and b may only share the third corners of the
+ * triangles on edge ab, one on a border and two inside. Any other shared
+ * neighbor would be pinched into a non-manifold edge by the collapse.
+ */
+static bool linkHolds(int a, int b, const vector<cv::Vec3i> &faces,
+                      const vector<unsigned char> &faceAlive,
+                      const vector<vector<int>> &vertexFaces,
+                      vector<int> &ringA, vector<int> &ringB) {
+    int edgeFaces = 0;
+    for (int f : vertexFaces.at(a)) {
+        const cv::Vec3i &t = faces.at(f);
+        if (faceAlive.at(f) && (t[0] == b || t[1] == b || t[2] == b)) {
+            edgeFaces++;
+        }
+    }
+    ringOf(a, faces, faceAlive, vertexFaces.at(a), ringA);
+    ringOf(b, faces, faceAlive, vertexFaces.at(b), ringB);
+    int shared = 0;
+    for (size_t i = 0, j = 0; i < ringA.size() && j < ringB.size();) {
+        if (ringA.at(i) < ringB.at(j)) {
+            i++;
+        } else if (ringB.at(j) < ringA.at(i)) {
+            j++;
+        } else {
+            shared++;
+            i++;
+            j++;
+        }
+    }
+    return edgeFaces > 0 && shared <= edgeFaces;
+}
+
+bool simplifyMesh(const Mesh &mesh, size_t maxTriangles, Mesh &simplified) {
+    int numVertices = mesh.vertices.size();
+    int numFaces = mesh.triangles.size();
+    vector<cv::Vec3d> positions(numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        const cv::Point3f &v = mesh.vertices.at(i);
+        positions.at(i) = cv::Vec3d(v.x, v.y, v.z);
+    }
+    vector<cv::Vec3i> faces = mesh.triangles;
+    vector<unsigned char> faceAlive(numFaces, 1);
+    vector<vector<int>> vertexFaces(numVertices);
+    vector<Quadric> quadrics(numVertices);
+
+    // 1. every vertex starts with the planes of its triangles, weighted by
+    // area, and the border with planes across it
+    size_t aliveFaces = 0;
+    for (int f = 0; f < numFaces; f++) {
+        const cv::Vec3i &t = faces.at(f);
+        if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) {
+            faceAlive.at(f) = 0;
+            continue;
+        }
+        aliveFaces++;
+        cv::Vec3d n = triangleNormal(positions.at(t[0]), positions.at(t[1]),
+                                     positions.at(t[2]));
+        double length = cv::norm(n);
+        if (length > 0) {
+            n /= length;
+            Quadric plane(n[0], n[1], n[2], -n.dot(positions.at(t[0])),
+                          length / 2);
+            for (int k = 0; k < 3; k++) {
+                quadrics.at(t[k]) += plane;
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            vertexFaces.at(t[k]).push_back(f);
+        }
+    }
+    for (const MeshEdge &edge : mesh.edges) {
+        if (edge.faces[1] >= 0) {
+            continue;
+        }
+        const cv::Vec3i &t = faces.at(edge.faces[0]);
+        cv::Vec3d p0 = positions.at(edge.v[0]);
+        cv::Vec3d side = positions.at(edge.v[1]) - p0;
+        cv::Vec3d across = side.cross(triangleNormal(
+            positions.at(t[0]), positions.at(t[1]), positions.at(t[2])));
+        double length = cv::norm(across);
+        if (length > 0) {
+            across /= length;
+            Quadric plane(across[0], across[1], across[2], -across.dot(p0),
+                          BORDER_WEIGHT * side.dot(side));
+            quadrics.at(edge.v[0]) += plane;
+            quadrics.at(edge.v[1]) += plane;
+        }
+    }
+
+    // 2. queue every edge, at the cheapest of the best point, its ends and
+    // its middle
+    vector<unsigned> stamps(numVertices, 0);
+    vector<unsigned char> vertexAlive(numVertices, 1);
+    std::priority_queue<Collapse> queue;
+    auto push = [&](int a, int b) {
+        Quadric q = quadrics.at(a);
+        q += quadrics.at(b);
+        const cv::Vec3d &pa = positions.at(a), &pb = positions.at(b);
+        cv::Vec3d candidates[4] = {pa, pb, (pa + pb) * 0.5, pa};
+        int numCandidates = 3;
+        cv::Vec3d best;
+        // - the best point is only trusted near the edge, it is far when q
+        // is nearly singular
+        if (q.minimum(best) && cv::norm(best - candidates[2]) <=
+                                   2 * cv::norm(pb - pa)) {
+            candidates[numCandidates++] = best;
+        }
+        Collapse collapse{HUGE_VAL, a, b, stamps.at(a), stamps.at(b), pa};
+        for (int i = 0; i < numCandidates; i++) {
+            double cost = q.error(candidates[i]);
+            if (cost < collapse.cost) {
+                collapse.cost = cost;
+                collapse.position = candidates[i];
+            }
+        }
+        queue.push(collapse);
+    };
+    for (const MeshEdge &edge : mesh.edges) {
+        push(edge.v[0], edge.v[1]);
+    }
+
+    // 3. collapse the cheapest edge, b into a, until small enough
+    bool collapsed = false;
+    vector<int> neighbors, ringA, ringB;
+    while (aliveFaces > maxTriangles && !queue.empty()) {
+        Collapse c = queue.top();
+        queue.pop();
+        int a = c.a, b = c.b;
+        if (!vertexAlive.at(a) || !vertexAlive.at(b) ||
+            stamps.at(a) != c.stampA || stamps.at(b) != c.stampB) {
+            continue;
+        }
+        if (!linkHolds(a, b, faces, faceAlive, vertexFaces, ringA, ringB)) {
+            continue;
+        }
+        if (foldsOver(a, b, c.position, positions, faces,
+                      vertexFaces.at(a)) ||
+            foldsOver(b, a, c.position, positions, faces,
+                      vertexFaces.at(b))) {
+            continue;
+        }
+
+        positions.at(a) = c.position;
+        quadrics.at(a) += quadrics.at(b);
+        vertexAlive.at(b) = 0;
+        stamps.at(a)++;
+        collapsed = true;
+
+        // - the triangles on the edge go, the others of b move to a
+        vector<int> &aroundA = vertexFaces.at(a);
+        for (int f : vertexFaces.at(b)) {
+            cv::Vec3i &t = faces.at(f);
+            if (!faceAlive.at(f)) {
+                continue;
+            }
+            if (t[0] == a || t[1] == a || t[2] == a) {
+                faceAlive.at(f) = 0;
+                aliveFaces--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                if (t[k] == b) {
+                    t[k] = a;
+                }
+            }
+            aroundA.push_back(f);
+        }
+        vector<int>().swap(vertexFaces.at(b));
+        aroundA.erase(std::remove_if(aroundA.begin(), aroundA.end(),
+                                     [&](int f) { return !faceAlive.at(f); }),
+                      aroundA.end());
+
+        // - the edges around a have new costs
+        neighbors.clear();
+        for (int f : aroundA) {
+            for (int k = 0; k < 3; k++) {
+                if (faces.at(f)[k] != a) {
+                    neighbors.push_back(faces.at(f)[k]);
+                }
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                        neighbors.end());
+        for (int n : neighbors) {
+            push(a, n);
+        }
+    }
+
+    // 4. keep the vertices still used, with new indices
+    simplified = Mesh();
+    vector<int> newIndex(numVertices, -1);
+    for (int f = 0; f < numFaces; f++) {
+        if (!faceAlive.at(f)) {
+            continue;
+        }
+        cv::Vec3i t = faces.at(f);
+        for (int k = 0; k < 3; k++) {
+            int &index = newIndex.at(t[k]);
+            if (index < 0) {
+                index = simplified.vertices.size();
+                const cv::Vec3d &p = positions.at(t[k]);
+                simplified.vertices.push_back(cv::Point3f(p[0], p[1], p[2]));
+            }
+            t[k] = index;
+        }
+        simplified.triangles.push_back(t);
+    }
+    return collapsed;
+}
+
+void buildLods(Mesh &mesh) {
+    // 1. bounding sphere around the middle of the bounding box
+    mesh.lods.clear();
+    mesh.center = cv::Point3f(0, 0, 0);
+    mesh.radius = 0;
+    if (mesh.vertices.empty()) {
+        return;
+    }
+    cv::Point3f low = mesh.vertices.at(0), high = low;
+    for (const cv::Point3f &v : mesh.vertices) {
+        low = cv::Point3f(std::min(low.x, v.x), std::min(low.y, v.y),
+                          std::min(low.z, v.z));
+        high = cv::Point3f(std::max(high.x, v.x), std::max(high.y, v.y),
+                           std::max(high.z, v.z));
+    }
+    mesh.center = (low + high) * 0.5f;
+    for (const cv::Point3f &v : mesh.vertices) {
+        mesh.radius = std::max(mesh.radius, (float)cv::norm(v - mesh.center));
+    }
+
+    // 2. each level from the one before, until too few triangles
+    mesh.lods.reserve(MAX_LODS);
+    const Mesh *finer = &mesh;
+    for (int i = 0; i < MAX_LODS; i++) {
+        size_t target = finer->triangles.size() * LOD_RATIO;
+        if (target < MIN_LOD_TRIANGLES) {
+            break;
+        }
+        Mesh lod;
+        // - stop when the collapses are blocked and it barely shrinks
+        if (!simplifyMesh(*finer, target, lod) ||
+            lod.triangles.size() > finer->triangles.size() * 3 / 4) {
+            break;
+        }
+        buildEdges(lod);
+        lod.center = mesh.center;
+        lod.radius = mesh.radius;
+        mesh.lods.push_back(std::move(lod));
+        finer = &mesh.lods.back();
+    }
+}
+
+const Mesh &chooseLod(const Mesh &mesh, double radius) {
+    double budget = CV_PI * radius * radius / PIXELS_PER_TRIANGLE;
+    const Mesh *lod = &mesh;
+    for (const Mesh &coarser : mesh.lods) {
+        if (lod->triangles.size() <= budget) {
+            break;
+        }
+        lod = &coarser;
+    }
+    return *lod;
+}
@@ -0,0 +1,51 @@
+//**********************************************************************************************************************
+// FILE: simplify.hpp
+//
+// DESCRIPTION
+// Levels of detail of the virtual objects. Meshes are simplified at load
+// time by collapsing the edges that change the shape the least (quadric
+// error metric), and the level drawn each frame is picked from the size of
+// the object in the image.
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <opencv2/opencv.hpp>
+
+#include "mesh.hpp"
+
+/**
+ * @brief Simplify a mesh by collapsing edges, cheapest first, until it has
+ * no more than a number of triangles. The border of an open mesh is kept in
+ * place and collapses that would fold a triangle over are skipped, so the
+ * result can have more triangles than asked for.
+ *
+ * @param mesh the mesh, with its edges
+ * @param maxTriangles the number of triangles to get down to
+ * @param simplified the output mesh, without edges
+ * @return true if at least one edge was collapsed
+ */
+bool simplifyMesh(const Mesh &mesh, size_t maxTriangles, Mesh &simplified);
+
+/**
+ * @brief Make the levels of detail of a mesh, each with about a quarter of
+ * the triangles of the one before, and its bounding sphere.
+ *
+ * @param mesh the mesh, with its edges. Its lods, center and radius are set
+ */
+void buildLods(Mesh &mesh);
+
+/**
+ * @brief Pick the level of detail for the size of an object in the image:
+ * the most detailed one with no more than one triangle every few pixels.
+ *
+ * @param mesh the mesh and its lods
+ * @param radius radius of the bounding sphere in the image, in pixels
+ * @return the mesh or one of its lods
+ */
+const Mesh &chooseLod(const Mesh &mesh, double radius);
+
+#endif
@@ -0,0 +1,224 @@
+//**********************************************************************************************************************
+// FILE: viewselect.cpp
+//
+// DESCRIPTION
+// Contains implementation for picking informative calibration views
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+
+#include "viewselect.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+using namespace std;
+
+// the image is split in GRID_COLS X GRID_ROWS cells to measure coverage
+static const int GRID_COLS = 8;
+static const int GRID_ROWS = 6;
+
+// weights of the score terms
+static const double COVERAGE_WEIGHT = 1.0;
+static const double TILT_WEIGHT = 1.0;
+static const double SHARPNESS_WEIGHT = 0.5;
+
+// angle between two board normals that counts as fully different
+static const double TILT_SATURATION = CV_PI / 6;
+
+// variance of laplacian that gives a sharpness of 0.5
+static const double SHARPNESS_HALF = 100.0;
+
+// coverage + tilt a view must add before the selector is full
+static const double MIN_NOVELTY = 0.05;
+
+ViewSelector::ViewSelector(cv::Size chessboardSize, cv::Size imageSize,
+                           int maxViews)
+    : chessboardSize(chessboardSize),
+      imageSize(imageSize),
+      maxViews(maxViews),
+      cellCount(GRID_COLS * GRID_ROWS, 0) {
+    // the focal length is unknown, the image width is a good enough guess to
+    // tell the tilts apart
+    double f = imageSize.width;
+    guessMatrix = (cv::Mat_<double>(3, 3) << f, 0, imageSize.width / 2.0, 0,
+                   f, imageSize.height / 2.0, 0, 0, 1);
+    createWorldPoints(chessboardSize, worldPoints);
+}
+
+bool ViewSelector::offer(cv::Mat &frame, int frameIdx) {
+    // 1. detect, the fast check rejects frames without a board cheaply
+    SelectedView view;
+    if (!findChessboard(frame, view.imagePoints, chessboardSize, true)) {
+        return false;
+    }
+    view.frameIdx = frameIdx;
+
+    // 2. coverage: which cells of the image have a corner in them
+    view.cells = 0;
+    for (int i = 0; i < view.imagePoints.size(); i++) {
+        int col = view.imagePoints.at(i).x * GRID_COLS / imageSize.width;
+        int row = view.imagePoints.at(i).y * GRID_ROWS / imageSize.height;
+        col = std::min(std::max(col, 0), GRID_COLS - 1);
+        row = std::min(std::max(row, 0), GRID_ROWS - 1);
+        view.cells |= 1ULL << (row * GRID_COLS + col);
+    }
+
+    // 3. tilt: the board normal is the third column of the rotation
+    cv::Mat rotVec, transVec, rotMatrix;
+    cv::solvePnP(worldPoints, view.imagePoints, guessMatrix, cv::Mat(), rotVec,
+                 transVec);
+    cv::Rodrigues(rotVec, rotMatrix);
+    view.normal = cv::Vec3d(rotMatrix.at<double>(0, 2),
+                            rotMatrix.at<double>(1, 2),
+                            rotMatrix.at<double>(2, 2));
+
+    // 4. sharpness: variance of the laplacian over the board only
+    cv::Rect board = cv::boundingRect(view.imagePoints) &
+                     cv::Rect(0, 0, frame.cols, frame.rows);
+    cv::Mat gray, laplacian;
+    cv::cvtColor(frame(board), gray, cv::COLOR_BGR2GRAY);
+    cv::Laplacian(gray, laplacian, CV_64F);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian, mean, stddev);
+    double variance = stddev[0] * stddev[0];
+    view.sharpness = variance / (variance + SHARPNESS_HALF);
+
+    // 5. not full yet: keep it unless it adds nothing
+    if (selected.size() < maxViews) {
+        double novelty =
+            gain(view, -1) - SHARPNESS_WEIGHT * view.sharpness;
+        if (!selected.empty() && novelty < MIN_NOVELTY) {
+            return false;
+        }
+    } else {
+        // 6. full: replace the least useful view if this one is better
+        int worst = 0;
+        double worstScore = contribution(0);
+        for (int i = 1; i < selected.size(); i++) {
+            double score = contribution(i);
+            if (score < worstScore) {
+                worst = i;
+                worstScore = score;
+            }
+        }
+        if (gain(view, worst) <= worstScore) {
+            return false;
+        }
+
+        for (int c = 0; c < cellCount.size(); c++) {
+            if (selected.at(worst).cells & (1ULL << c)) {
+                cellCount.at(c)--;
+            }
+        }
+        selected.erase(selected.begin() + worst);
+    }
+
+    for (int c = 0; c < cellCount.size(); c++) {
+        if (view.cells & (1ULL << c)) {
+            cellCount.at(c)++;
+        }
+    }
+    selected.push_back(view);
+    return true;
+}
+
+/**
+ * @brief How much a view would add to the selection, ignoring the selected
+ * view at index skip (-1 to ignore none).
+ */
+double ViewSelector::gain(const SelectedView &view, int skip) const {
+    // 1. cells nobody else covers
+    int newCells = 0;
+    int viewCells = 0;
+    for (int c = 0; c < cellCount.size(); c++) {
+        if (view.cells & (1ULL << c)) {
+            viewCells++;
+            int others = cellCount.at(c);
+            if (skip >= 0 && (selected.at(skip).cells & (1ULL << c))) {
+                others--;
+            }
+            if (others == 0) {
+                newCells++;
+            }
+        }
+    }
+    double coverage = viewCells > 0 ? (double)newCells / viewCells : 0;
+
+    // 2. angle to the closest tilt we already have
+    double minAngle = TILT_SATURATION;
+    for (int i = 0; i < selected.size(); i++) {
+        if (i == skip) {
+            continue;
+        }
+        double cosAngle = std::min(1.0, std::abs(view.normal.dot(
+                                            selected.at(i).normal)));
+        minAngle = std::min(minAngle, std::acos(cosAngle));
+    }
+    double tilt = minAngle / TILT_SATURATION;
+
+    return COVERAGE_WEIGHT * coverage + TILT_WEIGHT * tilt +
+           SHARPNESS_WEIGHT * view.sharpness;
+}
+
+/**
+ * @brief How much the selected view at idx adds to the rest of the selection
+ */
+double ViewSelector::contribution(int idx) const {
+    return gain(selected.at(idx), idx);
+}
+
+int selectViewsFromVideo(const string &videoPath, cv::Size chessboardSize,
+                         int maxViews,
+                         vector<vector<cv::Point2f>> &listImagePoints,
+                         vector<vector<cv::Point3f>> &listWorldPoints,
+                         vector<char *> &imageNames, cv::Size &imageSize) {
+    cv::VideoCapture video(videoPath);
+    if (!video.isOpened()) {
+        cout << "Unable to open video " << videoPath << endl;
+        return (-1);
+    }
+
+    // the size comes from the first frame, the capture properties are 0 for
+    // some streams and image sequences and ignore the rotation of the file
+    cv::Mat frame;
+    if (!video.read(frame) || frame.empty()) {
+        cout << "Unable to read a frame from video " << videoPath << endl;
+        return (-1);
+    }
+    imageSize = frame.size();
+    ViewSelector selector(chessboardSize, imageSize, maxViews);
+
+    // 1. offer every frame
+    int frameIdx = 0;
+    int kept = 0;
+    do {
+        if (selector.offer(frame, frameIdx)) {
+            kept++;
+        }
+        frameIdx++;
+    } while (video.read(frame));
+    cout << "scanned " << frameIdx << " frames, selection changed " << kept
+         << " times" << endl;
+
+    // 2. hand the selection over in frame order
+    vector<SelectedView> views = selector.views();
+    std::sort(views.begin(), views.end(),
+              [](const SelectedView &a, const SelectedView &b) {
+                  return a.frameIdx < b.frameIdx;
+              });
+
+    vector<cv::Point3f> worldPoints;
+    createWorldPoints(chessboardSize, worldPoints);
+    for (int i = 0; i < views.size(); i++) {
+        listImagePoints.push_back(views.at(i).imagePoints);
+        listWorldPoints.push_back(worldPoints);
+
+        string name = videoPath + ":" + to_string(views.at(i).frameIdx);
+        char *nameChar = new char[name.size() + 1];
+        strcpy(nameChar, name.c_str());
+        imageNames.push_back(nameChar);
+    }
+    return views.size();
+}
@@ -0,0 +1,91 @@
+//**********************************************************************************************************************
+// FILE: viewselect.hpp
+//
+// DESCRIPTION
+// Picks a small set of informative calibration views out of a long video
+//
+// AUTHOR
+// Sherly Hartono
+//**********************************************************************************************************************
+#ifndef VIEWSELECT_H
+#define VIEWSELECT_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "filter.hpp"
+
+/**
+ * @brief A chessboard detection kept by the selector
+ */
+struct SelectedView {
+    vector<cv::Point2f> imagePoints;  // corners of the chessboard
+    int frameIdx;                     // frame of the video it came from
+    unsigned long long cells;         // bit per grid cell with a corner in it
+    cv::Vec3d normal;                 // board normal in camera coordinates
+    double sharpness;                 // 0 (blurry) to 1 (sharp)
+};
+
+/**
+ * @brief Keeps at most maxViews chessboard views, chosen so that together they
+ * cover as much of the image as possible, look at the board from as many
+ * angles as possible and are sharp. A new view replaces the least useful view
+ * once the selector is full, so the calibration cost stays bounded no matter
+ * how many frames are offered.
+ */
+class ViewSelector {
+   public:
+    /**
+     * @param chessboardSize the width and height cell of the chessboard
+     * @param imageSize the size of the frames
+     * @param maxViews the maximum number of views to keep
+     */
+    ViewSelector(cv::Size chessboardSize, cv::Size imageSize, int maxViews);
+
+    /**
+     * @brief Detect the chessboard in a frame and keep it if it makes the
+     * selection more informative.
+     *
+     * @param frame the video frame
+     * @param frameIdx the index of the frame in the video
+     * @return true if the view was kept
+     */
+    bool offer(cv::Mat &frame, int frameIdx);
+
+    const vector<SelectedView> &views() const { return selected; }
+
+   private:
+    double gain(const SelectedView &view, int skip) const;
+    double contribution(int idx) const;
+
+    cv::Size chessboardSize;
+    cv::Size imageSize;
+    int maxViews;
+    cv::Mat guessMatrix;  // rough camera matrix to estimate the board tilt
+    vector<cv::Point3f> worldPoints;
+    vector<SelectedView> selected;
+    vector<int> cellCount;  // number of selected views covering each cell
+};
+
+/**
+ * @brief Scan a whole video and fill the lists with the views chosen by the
+ * ViewSelector, ready to be passed to calibrating.
+ *
+ * @param videoPath the video of the chessboard
+ * @param chessboardSize the width and height cell of the chessboard
+ * @param maxViews the maximum number of views to keep
+ * @param listImagePoints the list to push the 2D points to
+ * @param listWorldPoints the list to push the 3D points to
+ * @param imageNames the list to push the names (video:frame) to
+ * @param imageSize the output size of the video frames
+ * @return int -1 if the video could not be opened or read, else the number
+ * of views
+ */
+int selectViewsFromVideo(const string &videoPath, cv::Size chessboardSize,
+                         int maxViews,
+                         vector<vector<cv::Point2f>> &listImagePoints,
+                         vector<vector<cv::Point3f>> &listWorldPoints,
+                         vector<char *> &imageNames, cv::Size &imageSize);
+
+#endif